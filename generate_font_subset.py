@@ -0,0 +1,227 @@
+# UI で使う文字だけを efont から抜き出した U8g2 形式のフォントを生成する。
+# PlatformIO の pre スクリプトとして実行されるほか、単体でも実行できる:
+#   python generate_font_subset.py <M5GFX のディレクトリ>
+# 元のフォントが見つからない場合は何もせず、従来の efont がそのまま使われる。
+# 生成したフォントにない文字は、描画時に元の efont から引く
+# (common_header.h の font_fallback_t)。
+import glob
+import os
+import re
+import sys
+
+FONTS = [
+    # (生成するフォント名, 元の配列名)
+    ('cn_24', 'lgfx_efont_cn_24'),
+    ('ja_24', 'lgfx_efont_ja_24'),
+]
+# 文字列リテラルから使用文字を集めるソース
+SCAN_SOURCES = ['common_header.h', 'common_header.cpp', 'main.cpp']
+OUTPUT = os.path.join('resource', 'font_subset.h')
+# 検索表の1区画あたりのグリフ数
+BLOCK_GLYPHS = 16
+
+try:
+    Import('env')  # noqa: F821
+except NameError:
+    env = None
+
+
+def scan_string_chars(path):
+    """コメントを除いた文字列リテラル中の非ASCII文字を返す"""
+    with open(path, encoding='utf-8') as f:
+        text = f.read()
+    chars = set()
+    i = 0
+    n = len(text)
+    while i < n:
+        c = text[i]
+        if text.startswith('//', i):
+            i = text.find('\n', i)
+            if i < 0:
+                break
+        elif text.startswith('/*', i):
+            i = text.find('*/', i + 2)
+            if i < 0:
+                break
+            i += 2
+        elif c == "'":
+            i += 1
+            while i < n and text[i] != "'":
+                i += 2 if text[i] == '\\' else 1
+            i += 1
+        elif c == '"':
+            i += 1
+            while i < n and text[i] != '"':
+                if text[i] == '\\':
+                    i += 2
+                    continue
+                if ord(text[i]) > 0x7F:
+                    chars.add(text[i])
+                i += 1
+            i += 1
+        else:
+            i += 1
+    return chars
+
+
+def decode_c_string(body):
+    out = bytearray()
+    for lit in re.findall(r'"((?:[^"\\]|\\.)*)"', body, re.S):
+        i = 0
+        while i < len(lit):
+            c = lit[i]
+            if c != '\\':
+                out += c.encode('utf-8')
+                i += 1
+                continue
+            e = lit[i + 1]
+            if e in '01234567':
+                m = re.match(r'[0-7]{1,3}', lit[i + 1:])
+                out.append(int(m.group(0), 8) & 0xFF)
+                i += 1 + len(m.group(0))
+            elif e == 'x':
+                m = re.match(r'[0-9a-fA-F]+', lit[i + 2:])
+                out.append(int(m.group(0), 16) & 0xFF)
+                i += 2 + len(m.group(0))
+            else:
+                out += {'n': b'\n', 'r': b'\r', 't': b'\t', 'a': b'\a',
+                        'b': b'\b', 'f': b'\f', 'v': b'\v'}.get(
+                            e, e.encode('utf-8'))
+                i += 2
+    return bytes(out)
+
+
+def load_font_array(font_dir, name):
+    pattern = re.compile(r'\b' + name + r'\s*\[[^\]]*\][^=;]*=\s*')
+    for path in glob.glob(os.path.join(font_dir, '**', '*.[ch]*'),
+                          recursive=True):
+        with open(path, encoding='utf-8', errors='replace') as f:
+            text = f.read()
+        m = pattern.search(text)
+        if not m:
+            continue
+        end = text.index(';', m.end())
+        body = text[m.end():end]
+        if '"' in body:
+            return decode_c_string(body)
+        return bytes(int(v, 0) & 0xFF for v in
+                     re.findall(r'0[xX][0-9a-fA-F]+|\d+', body))
+    return None
+
+
+def word(data, pos):
+    return data[pos] << 8 | data[pos + 1]
+
+
+def read_unicode_glyphs(font):
+    """U8g2 フォントの Unicode 部のグリフを (コード, バイト列) で返す"""
+    table = 23 + word(font, 21)
+    pos = table + word(font, table)
+    glyphs = []
+    while pos + 2 < len(font):
+        code = word(font, pos)
+        if code == 0:
+            break
+        size = font[pos + 2]
+        glyphs.append((code, font[pos:pos + size]))
+        pos += size
+    return table, glyphs
+
+
+def build_subset(font, chars):
+    table, glyphs = read_unicode_glyphs(font)
+    glyphs = [g for g in glyphs if chr(g[0]) in chars]
+    blocks = [glyphs[i:i + BLOCK_GLYPHS]
+              for i in range(0, len(glyphs), BLOCK_GLYPHS)]
+
+    # 検索表: (前の区画の先頭からの距離, 区画内の最後のコード) の並び。
+    # 最後の 0xFFFF は終端 (コード 0) を指す
+    body = bytearray()
+    lookup = bytearray()
+    prev = -4 * (len(blocks) + 1)
+    for block in blocks:
+        lookup += (len(body) - prev).to_bytes(2, 'big')
+        lookup += block[-1][0].to_bytes(2, 'big')
+        prev = len(body)
+        for _, data in block:
+            body += data
+    lookup += (len(body) - prev).to_bytes(2, 'big') + b'\xff\xff'
+    body += b'\x00\x00'
+    return font[:table] + bytes(lookup) + bytes(body), len(glyphs)
+
+
+def find_glyph(font, code):
+    """U8g2 の検索手順で Unicode のグリフを探す (生成結果の確認用)"""
+    table = 23 + word(font, 21)
+    pos = table
+    while True:
+        pos += word(font, table)
+        e = word(font, table + 2)
+        table += 4
+        if e >= code:
+            break
+    while True:
+        e = word(font, pos)
+        if e == 0:
+            return False
+        if e == code:
+            return True
+        pos += font[pos + 2]
+
+
+def to_c_array(data):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append('    ' + ', '.join('0x%02X' % b for b in data[i:i + 16])
+                     + ',')
+    return '\n'.join(lines)
+
+
+def generate(src_dir, font_dir):
+    chars = set()
+    for name in SCAN_SOURCES:
+        path = os.path.join(src_dir, name)
+        if os.path.exists(path):
+            chars |= scan_string_chars(path)
+
+    out = ['// generate_font_subset.py により生成 (編集しないこと)',
+           '#pragma once', '', '#include <M5GFX.h>', '',
+           'namespace font_subset {']
+    for name, array in FONTS:
+        font = load_font_array(font_dir, array) if font_dir else None
+        if font is None or len(font) < 23 or word(font, 21) == 0:
+            print('font_subset: %s not found, using the full efont' % array)
+            return False
+        subset, count = build_subset(font, chars)
+        _, kept = read_unicode_glyphs(subset)
+        for code, _ in kept:
+            assert find_glyph(subset, code), 'U+%04X' % code
+        print('font_subset: %s %d glyphs, %d -> %d bytes' %
+              (name, count, len(font), len(subset)))
+        out += ['', 'extern const lgfx::U8g2font %s;' % name,
+                'static constexpr const uint8_t %s_data[] = {' % name,
+                to_c_array(subset), '};',
+                'const lgfx::U8g2font %s(%s_data);' % (name, name)]
+    out += ['}  // namespace font_subset', '']
+    text = '\n'.join(out)
+
+    path = os.path.join(src_dir, OUTPUT)
+    if os.path.exists(path):
+        with open(path, encoding='utf-8') as f:
+            if f.read() == text:
+                return True
+    with open(path, 'w', encoding='utf-8', newline='\n') as f:
+        f.write(text)
+    return True
+
+
+if env is not None:
+    project_dir = env.subst('$PROJECT_DIR')
+    libdeps_dir = os.path.join(env.subst('$PROJECT_LIBDEPS_DIR'),
+                               env.subst('$PIOENV'), 'M5GFX')
+    generate(os.path.join(project_dir, 'src'),
+             libdeps_dir if os.path.isdir(libdeps_dir) else None)
+elif __name__ == '__main__':
+    here = os.path.dirname(os.path.abspath(__file__))
+    generate(os.path.join(here, 'src'),
+             sys.argv[1] if len(sys.argv) > 1 else None)
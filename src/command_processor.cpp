@@ -22,6 +22,7 @@
 
 #include "i2c_master.hpp"
 #include "mlx90640.hpp"
+#include "still_accumulator.hpp"
 
 namespace command_processor {
 
@@ -50,12 +51,30 @@ static volatile int _idx_tempdata                = MLX_TEMP_ARRAY_SIZE - 1;
 static uint16_t* _mlx_framedatas[MLX_FRAMEDATA_ARRAY_SIZE];
 static m5::MLX90640_Class::temp_data_t* _mlx_tempdatas[MLX_TEMP_ARRAY_SIZE] = {
     nullptr};
+static m5::MLX90640_Class::radiance_data_t*
+    _mlx_radiancedatas[MLX_TEMP_ARRAY_SIZE] = {nullptr};
 static m5::MLX90640_Class::temp_data_t* _temp_data = nullptr;
+static uint32_t _calc_count                         = 0;
+static volatile bool _hold                          = false;
+static volatile bool _recalc_request                = false;
+static volatile bool _suspend_request               = false;
+static volatile bool _suspended                     = false;
+static bool _recalc_done                            = false;
 // static int16_t* _diff_data;
 
 static m5::MLX90640_Class::refresh_rate_t _refresh_rate;
 static uint8_t _noise_filter = 8;
 static uint8_t _emissivity   = 98;
+static int8_t _reflected     = reflected_auto;
+// 温度バッファの算出に使った値 (変更は recalcTemperatureData で反映する)
+static uint8_t _applied_emissivity = 98;
+static int8_t _applied_reflected   = reflected_auto;
+
+// 静止画撮影用の積算バッファ (サブページ毎に用意する)
+static still_accumulator_t* _still_accum = nullptr;
+static m5::MLX90640_Class::temp_data_t _still_tempdatas[2];
+static uint8_t _still_frames = 0;
+static bool _still_done      = false;
 
 /* clang-format off */
 static inline volatile uint32_t* get_gpio_hi_reg(int_fast8_t pin) { return (pin & 32) ? &GPIO.out1_w1ts.val : &GPIO.out_w1ts; }
@@ -108,6 +127,15 @@ static void IRAM_ATTR mlxTask(void* main_handle) {
     size_t discard_count = 2;
     uint8_t error_count  = 255;
     for (;;) {
+        if (_suspend_request) {
+            _suspended = true;
+            do {
+                vTaskDelay(1);
+            } while (_suspend_request);
+            _suspended = false;
+            // スリープ中は測定が途切れており、復帰直後のデータは使えない
+            discard_count = 2;
+        }
         if (error_count >= 128) {
             if (error_count == 128) {  // 強制的にSTOPコンディションを送信する
                 ESP_EARLY_LOGD("mlxTask", "I2C force stop");
@@ -183,8 +211,9 @@ static void IRAM_ATTR mlxTask(void* main_handle) {
     vTaskDelete(nullptr);
 }
 
-m5::MLX90640_Class::temp_data_t* getTemperatureData(void) {
-    return _mlx_tempdatas[_idx_tempdata];
+m5::MLX90640_Class::temp_data_t* getTemperatureData(size_t history) {
+    return _mlx_tempdatas[(_idx_tempdata + MLX_TEMP_ARRAY_SIZE - history) %
+                          MLX_TEMP_ARRAY_SIZE];
 }
 
 void setRate(uint8_t rate) {
@@ -194,7 +223,161 @@ void setFilter(uint8_t level) {
     _noise_filter = level;
 }
 void setEmissivity(uint8_t percent) {
-    _emissivity = percent > 100 ? 100 : percent;
+    if (percent > 100) {
+        percent = 100;
+    }
+    if (_emissivity != percent) {
+        _emissivity     = percent;
+        _recalc_request = true;
+    }
+}
+void setReflectedTemperature(int8_t celsius) {
+    if (celsius < reflected_auto) {
+        celsius = reflected_auto;
+    }
+    if (_reflected != celsius) {
+        _reflected      = celsius;
+        _recalc_request = true;
+    }
+}
+
+static void calcTempData(const m5::MLX90640_Class::radiance_data_t* radiance,
+                         m5::MLX90640_Class::temp_data_t* tempdata,
+                         uint8_t emissivity, int8_t reflected) {
+    float e = ((float)emissivity) / 100.0f;
+    if (reflected <= reflected_auto) {
+        _mlx.calcTempData(radiance, tempdata, e);
+    } else {
+        _mlx.calcTempData(radiance, tempdata, e, reflected);
+    }
+}
+
+// 複数フレームを積算して低ノイズの静止画を得る
+// frames : 各サブページの積算フレーム数 (外れ値は積算時に除外する)
+bool requestStillCapture(uint8_t frames) {
+    if (frames < 3 || frames > 64 || _still_accum != nullptr) return false;
+    _still_accum = (still_accumulator_t*)heap_caps_malloc(
+        sizeof(still_accumulator_t) * 2, MALLOC_CAP_8BIT);
+    if (_still_accum == nullptr) return false;
+    _still_accum[0].reset(frames);
+    _still_accum[1].reset(frames);
+    _still_frames = frames;
+    _still_done   = false;
+    return true;
+}
+
+bool isStillCapturing(void) {
+    return _still_accum != nullptr;
+}
+
+bool takeStillCaptureDone(void) {
+    bool result = _still_done;
+    _still_done = false;
+    return result;
+}
+
+m5::MLX90640_Class::temp_data_t* getStillData(size_t subpage) {
+    return &_still_tempdatas[subpage & 1];
+}
+
+static void accumulateStillFrame(const uint16_t* framedata) {
+    static uint16_t frame[2][still_accumulator_t::words + 2];
+    size_t subpage = framedata[833] & 1;
+    auto acc       = &_still_accum[subpage];
+    if (acc->count >= _still_frames) return;
+
+    acc->add(framedata);
+    frame[subpage][832] = framedata[832];
+    frame[subpage][833] = framedata[833];
+
+    if (_still_accum[0].count < _still_frames ||
+        _still_accum[1].count < _still_frames) {
+        return;
+    }
+
+    // 外れ値を除いた平均値から温度を１回だけ算出する
+    m5::MLX90640_Class::radiance_data_t radiance;
+    for (size_t sp = 0; sp < 2; ++sp) {
+        _still_accum[sp].getResult(frame[sp]);
+        _mlx.calcRadianceData(frame[sp], &radiance);
+        calcTempData(&radiance, &_still_tempdatas[sp], _applied_emissivity,
+                     _applied_reflected);
+    }
+    heap_caps_free(_still_accum);
+    _still_accum = nullptr;
+    _still_done  = true;
+}
+
+// 一時停止中はセンサデータの温度計算を止め、最後のデータを保持する
+void setHold(bool hold) {
+    _hold = hold;
+}
+
+bool suspendSensor(uint32_t timeout_ms) {
+    _suspend_request = true;
+    for (uint32_t ms = 0; !_suspended; ms += portTICK_PERIOD_MS) {
+        if (ms >= timeout_ms) {
+            _suspend_request = false;
+            return false;
+        }
+        vTaskDelay(1);
+    }
+    return true;
+}
+
+void resumeSensor(void) {
+    _suspend_request = false;
+    while (_suspended) {
+        vTaskDelay(1);
+    }
+}
+
+// 放射率・反射温度の変更を、保持している赤外信号から直近２サブページ分の
+// 温度に反映する。ノイズフィルタを通した値を保つため、同じ赤外信号から
+// 求めた変更前後の温度の差だけを加える。
+// 温度バッファを書き換える loop() の中で、新しいサブページの計算より先に
+// 実行するため、計算途中のバッファと入れ違いになることはない
+static bool recalcTemperatureData(void) {
+    if (!_recalc_request) return false;
+    _recalc_request    = false;
+    uint8_t emissivity = _emissivity;
+    int8_t reflected   = _reflected;
+    bool result        = (_calc_count >= 2);
+    if (_applied_emissivity == emissivity && _applied_reflected == reflected) {
+        result = false;
+    }
+    if (result) {
+        static m5::MLX90640_Class::temp_data_t before;
+        static m5::MLX90640_Class::temp_data_t after;
+        for (size_t i = 0; i < 2; ++i) {
+            int idx = (_idx_tempdata + MLX_TEMP_ARRAY_SIZE - i) %
+                      MLX_TEMP_ARRAY_SIZE;
+            auto radiance = _mlx_radiancedatas[idx];
+            auto tempdata = _mlx_tempdatas[idx];
+            calcTempData(radiance, &before, _applied_emissivity,
+                         _applied_reflected);
+            calcTempData(radiance, &after, emissivity, reflected);
+            for (size_t j = 0; j < 384; ++j) {
+                int32_t t = tempdata->data[j] + after.data[j] - before.data[j];
+                if (t < 0) {
+                    t = 0;
+                } else if (t > UINT16_MAX) {
+                    t = UINT16_MAX;
+                }
+                tempdata->data[j] = t;
+            }
+        }
+    }
+    _applied_emissivity = emissivity;
+    _applied_reflected  = reflected;
+    return result;
+}
+
+// 直前の loop() で温度を再計算した場合に true を返す
+bool takeRecalcDone(void) {
+    bool result  = _recalc_done;
+    _recalc_done = false;
+    return result;
 }
 
 void setup(void) {
@@ -215,10 +398,20 @@ void setup(void) {
         _mlx_tempdatas[i] = (m5::MLX90640_Class::temp_data_t*)heap_caps_malloc(
             sizeof(m5::MLX90640_Class::temp_data_t), MALLOC_CAP_DMA);
         memset(_mlx_tempdatas[i], 0, sizeof(m5::MLX90640_Class::temp_data_t));
+        _mlx_radiancedatas[i] =
+            (m5::MLX90640_Class::radiance_data_t*)heap_caps_malloc(
+                sizeof(m5::MLX90640_Class::radiance_data_t), MALLOC_CAP_8BIT);
+        memset(_mlx_radiancedatas[i], 0,
+               sizeof(m5::MLX90640_Class::radiance_data_t));
     }
 }
 
 bool IRAM_ATTR loop(void) {
+    // (一時停止中も新しいセンサデータを待たずに反映する)
+    if (recalcTemperatureData()) {
+        _recalc_done = true;
+    }
+
     static int prev_idx_framedata = -1;
     if (prev_idx_framedata == _idx_framedata) return false;
     // if (prev_idx_framedata != _idx_framedata)
@@ -237,14 +430,23 @@ bool IRAM_ATTR loop(void) {
         prev_idx_framedata = prev_idx_framedata < MLX_FRAMEDATA_ARRAY_SIZE - 1
                                  ? prev_idx_framedata + 1
                                  : 0;
+        if (_still_accum) {
+            accumulateStillFrame(_mlx_framedatas[prev_idx_framedata]);
+        }
+        if (_hold) return false;
+
         // auto prev_temp_data = _mlx_tempdatas[_idx_tempdata];
         int idx =
             _idx_tempdata < MLX_TEMP_ARRAY_SIZE - 1 ? _idx_tempdata + 1 : 0;
         _temp_data = _mlx_tempdatas[idx];
 
-        float emissivity = ((float)_emissivity) / 100.0f;
-        _mlx.calcTempData(_mlx_framedatas[prev_idx_framedata], _temp_data,
-                          emissivity);
+        _mlx.calcRadianceData(_mlx_framedatas[prev_idx_framedata],
+                              _mlx_radiancedatas[idx]);
+        calcTempData(_mlx_radiancedatas[idx], _temp_data, _applied_emissivity,
+                     _applied_reflected);
+        if (_calc_count < UINT32_MAX) {
+            ++_calc_count;
+        }
 
         auto prev_temp_data = _mlx_tempdatas[(idx + MLX_TEMP_ARRAY_SIZE - 2) %
                                              MLX_TEMP_ARRAY_SIZE];
@@ -22,9 +22,23 @@ void prepareTxData(void);
 void setRate(uint8_t rate);
 void setFilter(uint8_t level);
 void setEmissivity(uint8_t percent);
+// celsius : 反射温度。reflected_auto 以下ではセンサ周囲温度から推定する
+static constexpr const int8_t reflected_auto = -41;
+void setReflectedTemperature(int8_t celsius);
+void setHold(bool hold);
+// ライトスリープの前後で使う。センサの読み出しを止め、途中の読み出しが
+// 終わるのを待つ。timeout_ms 以内に止まらなければ false を返す
+bool suspendSensor(uint32_t timeout_ms);
+// 読み出しを再開する。復帰直後の１組 (２サブページ) は破棄する
+void resumeSensor(void);
+bool takeRecalcDone(void);
+bool requestStillCapture(uint8_t frames);
+bool isStillCapturing(void);
+bool takeStillCaptureDone(void);
+m5::MLX90640_Class::temp_data_t* getStillData(size_t subpage);
 uint32_t getRecvCount(void);
 void updateBattery(void);
 int8_t getBatteryLevel(void);
 int8_t getBatteryState(void);
-m5::MLX90640_Class::temp_data_t* getTemperatureData(void);
+m5::MLX90640_Class::temp_data_t* getTemperatureData(size_t history = 0);
 }  // namespace command_processor
@@ -4,6 +4,15 @@
 
 #include "common_header.h"
 
+#if USE_FONT_SUBSET
+#include "resource/font_subset.h"
+
+namespace font_subset {
+const font_fallback_t cn_24_fallback(&cn_24, &fonts::efontCN_24);
+const font_fallback_t ja_24_fallback(&ja_24, &fonts::efontJA_24);
+}  // namespace font_subset
+#endif
+
 uint8_t config_save_countdown           = 0;
 uint8_t localize_text_t::localize_index = 0;
 
@@ -19,3 +28,5 @@ constexpr const uint16_t config_param_t::cloud_interval_value[];
 constexpr const uint8_t config_param_t::misc_brightness_value[];
 constexpr const uint8_t config_param_t::misc_volume_value[];
 constexpr const lgfx::IFont* config_param_t::misc_language_value[];
+
+constexpr const uint32_t graph_data_t::tier_period_msec[];
@@ -3,6 +3,8 @@
 #include <M5GFX.h>
 #include <WiFi.h>
 
+#include "image_interp.hpp"
+
 static constexpr const uint8_t firmware_ver_major = 0;
 static constexpr const uint8_t firmware_ver_minor = 0;
 static constexpr const uint8_t firmware_ver_patch = 11;
@@ -27,6 +29,55 @@ static constexpr const char wday_tbl[7][4] = {
 
 #define SIZEOF_ARRAY(a) (sizeof(a) / sizeof(a[0]))
 
+// UI で使う文字だけを抜き出したフォント (generate_font_subset.py で生成)。
+// 生成されていない場合は efont をそのまま使う
+#if __has_include("resource/font_subset.h")
+#define USE_FONT_SUBSET 1
+
+// サブセットにない文字 (SSID など実行時に決まる文字列や、抜き出しの対象外の
+// ソースの文字列) は元の efont で描く。サブセットにある文字は元の efont を
+// 参照しない
+struct font_fallback_t : public lgfx::IFont {
+    constexpr font_fallback_t(const lgfx::U8g2font* subset,
+                              const lgfx::IFont* full)
+        : _subset(subset), _full(full) {
+    }
+    font_type_t getType(void) const override {
+        return _subset->getType();
+    }
+    void getDefaultMetric(lgfx::FontMetrics* metrics) const override {
+        _subset->getDefaultMetric(metrics);
+    }
+    bool updateFontMetric(lgfx::FontMetrics* metrics,
+                          uint16_t uniCode) const override {
+        return select(uniCode)->updateFontMetric(metrics, uniCode);
+    }
+    size_t drawChar(lgfx::LGFXBase* gfx, int32_t x, int32_t y, uint16_t c,
+                    const lgfx::TextStyle* style, lgfx::FontMetrics* metrics,
+                    int32_t& filled_x) const override {
+        return select(c)->drawChar(gfx, x, y, c, style, metrics, filled_x);
+    }
+
+   private:
+    const lgfx::U8g2font* _subset;
+    const lgfx::IFont* _full;
+
+    const lgfx::IFont* select(uint16_t c) const {
+        if (_subset->getGlyph(c) != nullptr) {
+            return _subset;
+        }
+        return _full;
+    }
+};
+
+namespace font_subset {
+extern const lgfx::U8g2font cn_24;
+extern const lgfx::U8g2font ja_24;
+extern const font_fallback_t cn_24_fallback;
+extern const font_fallback_t ja_24_fallback;
+}  // namespace font_subset
+#endif
+
 static constexpr const uint16_t color_map_table[][256] = {
     {
         // colormap_golden
@@ -549,6 +600,88 @@ static constexpr const lgfx::swap565_t icon_wifi565[][16 * 14] = {
     },
 };
 
+// 監視エリア内の温度ヒストグラム。フレームごとに1回だけ集計し、
+// 中央値・パーセンタイル・ヒストグラム表示で共用する。
+struct frame_histogram_t {
+    static constexpr const size_t bin_count = 128;
+    uint16_t base;   // 先頭ビンの下限値 (raw)
+    uint8_t shift;   // ビン幅 = 1 << shift
+    uint16_t total;  // 集計したピクセル数
+    uint16_t bins[bin_count];
+
+    void build(const uint16_t* pixel_raw, uint16_t lowest, uint16_t highest,
+               uint8_t monix, uint8_t moniy);
+    // permille : 0 ~ 1000
+    uint16_t percentile(uint32_t permille) const;
+    uint16_t median(void) const {
+        return percentile(500);
+    }
+};
+
+// 高温領域 (ホットスポット) の検出結果
+struct blob_t {
+    uint16_t area;  // ピクセル数
+    uint16_t peak;  // 領域内の最高温度 (raw)
+    uint16_t cx;    // 重心 (1/16ピクセル単位)
+    uint16_t cy;
+    uint8_t peak_x;
+    uint8_t peak_y;
+    uint8_t id;  // フレーム間で同じ領域に割り当てられる追跡ID (1~255, 0:なし)
+};
+
+// ヒストグラムを基準にした閾値以上のピクセルを4近傍で連結し、
+// 最高温度の高い順に blob_max 個まで保持する。
+// track が false の場合 (静止画や再計算したフレーム) は前回の追跡IDを
+// 引き継ぐだけで新しいIDを割り当てない (該当しない領域のIDは0)
+struct blob_list_t {
+    static constexpr const size_t blob_max = 8;
+    uint8_t count;
+    blob_t blobs[blob_max];
+
+    void detect(const uint16_t* pixel_raw, const frame_histogram_t& hist,
+                bool track = true);
+};
+
+// ユーザー定義の矩形監視領域 (ROI)。w または h が 0 なら無効
+struct roi_rect_t {
+    uint8_t x;
+    uint8_t y;
+    uint8_t w;
+    uint8_t h;
+};
+
+// 領域ごとの統計値
+struct roi_result_t {
+    uint16_t lowest;
+    uint16_t highest;
+    uint16_t average;
+    uint8_t low_x;
+    uint8_t low_y;
+    uint8_t high_x;
+    uint8_t high_y;
+};
+
+// 任意の矩形領域の統計を求めるためのテーブル。フレームごとに1回作成する。
+// 合計は積分画像から O(1) で、最低・最高温度は行ごとの区間テーブルから
+// O(行数) で求める。
+class roi_engine_t {
+   public:
+    static constexpr const size_t roi_max = 4;
+
+    void build(const uint16_t* pixel_raw);
+    bool query(const roi_rect_t& rect, roi_result_t* result) const;
+
+   private:
+    // 区間長 2^1 ~ 2^5 (= frame_width) の段数
+    static constexpr const size_t level_max = 5;
+
+    const uint16_t* _pixel_raw = nullptr;
+    uint32_t _sum[(frame_height + 1) * (frame_width + 1)];
+    // 各行の [x, x + 2^(level+1)) における最低・最高温度のX座標
+    uint8_t _min_x[level_max][frame_height][frame_width];
+    uint8_t _max_x[level_max][frame_height][frame_width];
+};
+
 struct framedata_t {
     enum {
         center,
@@ -563,9 +696,67 @@ struct framedata_t {
     uint8_t low_y;
     uint8_t high_x;
     uint8_t high_y;
+    frame_histogram_t histogram;
+    roi_result_t roi[roi_engine_t::roi_max];
+    blob_list_t blobs;
+    uint16_t change_score;  // 背景および前回値から変化したピクセル数
+    uint16_t median;        // 監視エリアの中央値
+    uint16_t hotspot;  // 最も高温な領域の最高温度 (領域がなければ最高温度)
     std::string getJsonData(void) const;
 };
 
+// アラーム判定ルール (Web APIから設定し、NVSに保存する)
+struct alarm_rule_t {
+    uint8_t mode;         // alarm_mode_t (0 : 無効)
+    uint8_t source;       // 0 : 監視エリア, 1~ : ROI番号 + 1
+    uint8_t reference;    // alarm_reference_t
+    uint8_t rate;         // 0 : 温度で判定, 1 : 1秒あたりの変化量で判定
+    int32_t threshold;    // 温度 (raw値) / 変化量 (raw値/秒)
+    uint16_t hysteresis;  // 解除までに戻る幅 (raw値)
+    uint16_t duration;    // 発報までの継続時間 (msec)
+};
+
+// ルールを参照値の位置と判定レベルだけの平坦なテーブルに変換して保持し、
+// フレームごとに評価する。評価コストはルール数のみに比例する。
+class alarm_engine_t {
+   public:
+    static constexpr const size_t rule_max = 8;
+
+    // ルールまたは領域設定が前回と異なる場合のみテーブルを作り直す
+    void setRules(const alarm_rule_t* rules, size_t count,
+                  const roi_rect_t* rois);
+    // いずれかのルールが発報中なら true
+    bool evaluate(const framedata_t* frame, uint32_t msec);
+    // 発報中のルールのビット (ルール番号順)
+    uint32_t getActiveMask(void) const {
+        return _active_mask;
+    }
+
+   private:
+    struct entry_t {
+        uint16_t offset;  // framedata_t 内の参照値 (uint16_t) の位置
+        int8_t sign;      // 下限判定は符号を反転して上限判定として扱う
+        uint8_t rate;
+        uint8_t index;  // 元のルール番号
+        bool active;
+        uint16_t duration;
+        int32_t on_level;
+        int32_t off_level;
+        uint32_t since_msec;  // 条件成立時刻 (0 : 不成立)
+        int32_t ref_value;    // 変化量算出の基準値
+        uint32_t ref_msec;
+        int32_t rate_value;
+    };
+    void compile(void);
+
+    alarm_rule_t _rules[rule_max + 1];
+    roi_rect_t _rois[roi_engine_t::roi_max];
+    size_t _rule_count = 0;
+    entry_t _entries[rule_max + 1];
+    size_t _entry_count   = 0;
+    uint32_t _active_mask = 0;
+};
+
 struct value_smooth_t {
     int32_t exec(int32_t src, int32_t margin);
     void set(int32_t default_value);
@@ -576,14 +767,158 @@ struct value_smooth_t {
     int32_t _current;
 };
 
-// グラフ表示のためのデータ蓄積用構造体
-struct graph_data_t {
+// 処理段ごとの CPU 使用時間を1秒単位で集計する
+struct busy_meter_t {
+    // 直近1秒間の合計 (usec)
+    volatile uint32_t usec = 0;
+
+    void add(uint32_t elapsed_usec, uint32_t msec) {
+        if (msec - _start_msec >= 1000) {
+            usec        = _sum;
+            _sum        = 0;
+            _start_msec = msec;
+        }
+        _sum += elapsed_usec;
+    }
+
+   private:
+    uint32_t _sum        = 0;
+    uint32_t _start_msec = 0;
+};
+
+// アラーム発報までの様子を残すための直近フレームの記録。
+// 温度を 1/32℃ 単位に丸め、前フレームとの差分 (キーフレームは左隣との差分)
+// を Rice 符号で圧縮してリングバッファに格納する。
+// アラームの立ち上がりで記録を凍結し、Web API から1フレームずつ取り出す。
+class frame_recorder_t {
+   public:
+    static constexpr const size_t buffer_size     = 32768;  // 2の累乗とする
+    static constexpr const size_t record_max      = 128;
+    static constexpr const uint8_t key_interval   = 16;
+    static constexpr const uint8_t quantize_shift = 2;
+
+    bool setup(void);
+    // loop から新しいフレーム毎に呼ぶ。trigger の立ち上がりで凍結する
+    void record(const uint16_t* pixel_raw, uint32_t msec, bool trigger);
+    // Web側から要求し、次の record で記録を再開する
+    void requestRearm(void) {
+        _rearm_request = true;
+    }
+    bool isFrozen(void) const {
+        return _frozen;
+    }
+    size_t getFrameCount(void) const {
+        return _record_count;
+    }
+    size_t getUsedBytes(void) const {
+        return _write_pos - _read_pos;
+    }
+    uint32_t getTriggerMsec(void) const {
+        return _trigger_msec;
+    }
+    // 凍結中のみ有効。index 0 が最も古いフレーム
+    bool decode(size_t index, uint16_t* pixel_raw, uint32_t* msec) const;
+
+   private:
+    struct record_t {
+        uint32_t pos;
+        uint32_t msec;
+        uint8_t k;
+        bool key;
+    };
+    void clear(void);
+    void evictGroup(void);
+    uint8_t* _buffer = nullptr;
+    record_t _records[record_max];
+    size_t _record_head  = 0;
+    size_t _record_count = 0;
+    uint32_t _write_pos  = 0;
+    uint32_t _read_pos   = 0;
+    uint16_t _prev_q[frame_width * frame_height];
+    uint8_t _since_key     = 0;
+    uint32_t _trigger_msec = 0;
+    bool _prev_trigger     = false;
+    volatile bool _frozen        = false;
+    volatile bool _rearm_request = false;
+};
+
+// グラフ表示用の履歴1段分。直近 window 件の最低・最高温度を単調キューで保持し、
+// 1件追加あたり O(1) で表示範囲を求められるようにする
+struct graph_history_t {
     // 要素数は256固定とする。インデクスをuint8_tとすることで履歴の記録を簡素化する
-    static constexpr const uint16_t data_len = 256;
-    uint16_t* temp_arrays[4]                 = {
+    static constexpr const uint16_t data_len   = 256;
+    static constexpr const uint16_t window_max = data_len - 1;
+    // framedata_t の添字順。集約段では center を持たず nullptr とする
+    uint16_t* temp_arrays[4] = {
         nullptr,
     };
     uint8_t current_idx = 0;
+    // 記録済みの件数 (data_len で飽和)
+    uint16_t count = 0;
+
+    void fill(const uint16_t* temp);
+    void push(const uint16_t* temp);
+    // 描画側から要求し、記録側 (applyWindow) で反映する
+    void setWindow(uint16_t window) {
+        _request_window = (window < 1)            ? 1
+                          : (window > window_max) ? window_max
+                                                  : window;
+    }
+    void applyWindow(void);
+    uint16_t getLowest(void) const {
+        return temp_arrays[framedata_t::lowest][_low_queue[_low_head]];
+    }
+    uint16_t getHighest(void) const {
+        return temp_arrays[framedata_t::highest][_high_queue[_high_head]];
+    }
+
+   private:
+    void rebuild(void);
+    // 値が単調増加 (low) / 単調減少 (high) となるインデクスの列
+    uint8_t _low_queue[data_len];
+    uint8_t _high_queue[data_len];
+    uint8_t _low_head  = 0;
+    uint8_t _low_tail  = 0;
+    uint8_t _high_head = 0;
+    uint8_t _high_tail = 0;
+    uint16_t _window   = window_max;
+    volatile uint16_t _request_window = window_max;
+};
+
+// 集約段へ送る前の min/avg/max 積算値
+struct graph_accum_t {
+    uint16_t lowest;
+    uint16_t highest;
+    uint32_t average_sum;
+    uint32_t count = 0;
+
+    void add(const uint16_t* temp);
+    // 積算結果を temp に書き出し、積算値をリセットする
+    bool take(uint16_t* temp);
+};
+
+// グラフ表示のためのデータ蓄積用構造体
+// フレーム毎の履歴に加え、1秒毎・1分毎に集約した履歴を持つ
+struct graph_data_t {
+    enum tier_t {
+        tier_live,
+        tier_second,
+        tier_minute,
+        tier_max,
+    };
+    static constexpr const uint32_t tier_period_msec[] = {0, 1000, 60000};
+
+    graph_history_t history[tier_max];
+
+    void setup(void);
+    void fill(const uint16_t* temp);
+    void push(const uint16_t* temp, uint32_t msec);
+
+   private:
+    graph_accum_t _second_accum;
+    graph_accum_t _minute_accum;
+    uint32_t _second_msec = 0;
+    uint8_t _minute_seconds = 0;
 };
 
 extern uint8_t config_save_countdown;
@@ -854,6 +1189,8 @@ struct config_param_t {
         alarm_reference_lowest,
         alarm_reference_center,
         alarm_reference_average,
+        alarm_reference_median,
+        alarm_reference_hotspot,
         alarm_reference_max,
     };
     // static constexpr const char* alarm_reference_text[] = { "Highest",
@@ -919,6 +1256,23 @@ struct config_param_t {
     static constexpr const uint8_t sens_monitorarea_value[] = {
         0x88u, 0xAAu, 0xCC, 0xEC, 0xFC};
 
+    enum sens_scenegate_t {
+        sens_scenegate_off,
+        sens_scenegate_on,
+        sens_scenegate_max,
+    };
+
+    enum sens_scenesens_t {
+        sens_scenesens_low,
+        sens_scenesens_middle,
+        sens_scenesens_high,
+        sens_scenesens_max,
+    };
+    // 変化判定の閾値 (ピクセルごとのノイズ推定値に対する倍率)
+    static constexpr const uint8_t sens_scenesens_gain[] = {6, 4, 3};
+    // フレームを変化ありと判定するピクセル数
+    static constexpr const uint8_t sens_scenesens_pixels[] = {12, 6, 3};
+
     enum range_autoswitch_t {
         range_autoswitch_off,
         range_autoswitch_on,
@@ -947,8 +1301,14 @@ struct config_param_t {
     // &fonts::DejaVu12, &fonts::DejaVu18, &fonts::DejaVu24 }; static constexpr
     // const lgfx::IFont* misc_language_value[] = { &fonts::efontJA_14,
     // &fonts::efontJA_16, &fonts::efontJA_24 };
+#if USE_FONT_SUBSET
+    static constexpr const lgfx::IFont* misc_language_value[] = {
+        &font_subset::cn_24_fallback, &font_subset::cn_24_fallback,
+        &font_subset::ja_24_fallback};
+#else
     static constexpr const lgfx::IFont* misc_language_value[] = {
         &fonts::efontCN_24, &fonts::efontCN_24, &fonts::efontJA_24};
+#endif
 
     enum misc_pointer_t {
         misc_pointer_off,
@@ -956,6 +1316,43 @@ struct config_param_t {
         misc_pointer_pointtxt,
         misc_pointer_max,
     };
+
+    enum misc_governor_t {
+        misc_governor_off,
+        misc_governor_on,
+        misc_governor_max,
+    };
+
+    enum misc_headless_t {
+        misc_headless_off,
+        misc_headless_on,
+        misc_headless_max,
+    };
+
+    enum misc_graphspan_t {
+        misc_graphspan_live,
+        misc_graphspan_second,
+        misc_graphspan_minute,
+        misc_graphspan_max,
+    };
+
+    enum misc_upscale_t {
+        misc_upscale_bilinear,
+        misc_upscale_bicubic,
+        misc_upscale_max,
+    };
+
+    enum misc_dualcore_t {
+        misc_dualcore_off,
+        misc_dualcore_on,
+        misc_dualcore_max,
+    };
+
+    enum misc_drawbuf_t {
+        misc_drawbuf_16bit,
+        misc_drawbuf_8bit,
+        misc_drawbuf_max,
+    };
     // static constexpr const char* misc_pointer_text[] = { "Off", "Point",
     // "Point+Value" };
 
@@ -984,6 +1381,12 @@ struct config_param_t {
         misc_color_max,
     };
 
+    enum cloud_dutycycle_t {
+        cloud_dutycycle_off,
+        cloud_dutycycle_on,
+        cloud_dutycycle_max,
+    };
+
     enum cloud_interval_t {
         cloud_interval_5sec,
         cloud_interval_10sec,
@@ -1014,6 +1417,17 @@ struct config_param_t {
         snprintf(text_buf, buf_len, "%d %%", v);
     }
 
+    // 反射温度の最小値は自動 (センサ周囲温度から推定する)
+    static constexpr const int8_t sens_reflected_auto = -41;
+    static void sens_reflected_text_func(char* text_buf, size_t buf_len,
+                                         int8_t v) {
+        if (v <= sens_reflected_auto) {
+            snprintf(text_buf, buf_len, "Auto");
+        } else {
+            snprintf(text_buf, buf_len, "%dC", v);
+        }
+    }
+
     static void uint8_t_text_func(char* text_buf, size_t buf_len, uint8_t v) {
         snprintf(text_buf, buf_len, "%d", v);
     }
@@ -1042,6 +1456,7 @@ struct config_param_t {
     static void sens_refreshrate_func(sens_refreshrate_t);
     static void sens_noisefilter_func(sens_noisefilter_t);
     static void perf_emissivity_func(uint8_t);
+    static void sens_reflected_func(int8_t);
     static void range_temperature_func(int32_t);
     // static void net_wifi_mode_func(net_wifi_mode_t);
     static void misc_brightness_func(misc_brightness_t);
@@ -1088,6 +1503,17 @@ struct config_param_t {
         cloud_interval_t ::cloud_interval_30sec,
         cloud_interval_t ::cloud_interval_max};
 
+    // 送信間隔が10分以上の場合、送信の合間はライトスリープする
+    // (画面なし・クラウドのみの動作時に有効)
+    config_property_localize_enum_t<cloud_dutycycle_t> cloud_dutycycle = {
+        {"Sleep Between", "间歇休眠", "送信間スリープ"},
+        (const localize_text_t[]){
+            {"Off", "关闭", "無効"},
+            {"On", "打开", "有効"},
+        },
+        cloud_dutycycle_t ::cloud_dutycycle_off,
+        cloud_dutycycle_t ::cloud_dutycycle_max};
+
     config_property_value_t<uint16_t> alarm_temperature = {
         alarm_temperature_text_func, (100 + 64) * 128, (-50 + 64) * 128,
         (350 + 64) * 128, 32};
@@ -1109,6 +1535,8 @@ struct config_param_t {
             {"Lowest", "最低温度", "最低温度"},
             {"Center", "中央温度", "中央温度"},
             {"Average", "平均温度", "平均温度"},
+            {"Median", "中位温度", "中央値"},
+            {"Hotspot", "热点", "ホットスポット"},
         },
         alarm_reference_t ::alarm_reference_highest,
         alarm_reference_t ::alarm_reference_max};
@@ -1152,9 +1580,38 @@ struct config_param_t {
         sens_monitorarea_t::sens_monitorarea_30x24,
         sens_monitorarea_t::sens_monitorarea_max};
 
+    // 画面に変化がない間は描画・画像配信・クラウド送信を間引く
+    config_property_localize_enum_t<sens_scenegate_t> sens_scenegate = {
+        {"Idle Skip", "静止省电", "静止時省電力"},
+        (const localize_text_t[]){
+            {"Off", "关闭", "無効"},
+            {"On", "打开", "有効"},
+        },
+        sens_scenegate_t::sens_scenegate_off,
+        sens_scenegate_t::sens_scenegate_max};
+
+    config_property_localize_enum_t<sens_scenesens_t> sens_scenesens = {
+        {"Change Sense", "变化灵敏度", "変化検出感度"},
+        (const localize_text_t[]){
+            {"Low", "低", "低"},
+            {"Middle", "中", "中"},
+            {"High", "高", "高"},
+        },
+        sens_scenesens_t::sens_scenesens_middle,
+        sens_scenesens_t::sens_scenesens_max};
+
     config_property_value_t<uint8_t> sens_emissivity = {
         perf_emissivity_text_func, 98, 20, 100, 1, perf_emissivity_func};
 
+    // 反射温度 (放射率が低い対象で周囲から映り込む温度)
+    config_property_value_t<int8_t> sens_reflected = {
+        sens_reflected_text_func,
+        sens_reflected_auto,
+        sens_reflected_auto,
+        100,
+        1,
+        sens_reflected_func};
+
     config_property_localize_enum_t<range_autoswitch_t> range_autoswitch = {
         {"Auto Range", "自动量程", "自動レンジ"},
         (const localize_text_t[]){
@@ -1223,6 +1680,68 @@ struct config_param_t {
         misc_pointer_t ::misc_pointer_pointtxt,
         misc_pointer_t ::misc_pointer_max};
 
+    // 静止状態が続いたら更新レートと CPU クロックを自動で下げる
+    config_property_localize_enum_t<misc_governor_t> misc_governor = {
+        {"Auto Power", "自动节能", "自動省電力"},
+        (const localize_text_t[]){
+            {"Off", "关闭", "無効"},
+            {"On", "打开", "有効"},
+        },
+        misc_governor_t ::misc_governor_off,
+        misc_governor_t ::misc_governor_max};
+
+    // 画面を消灯して描画を止め、LAN/クラウドへの出力のみ行う
+    config_property_localize_enum_t<misc_headless_t> misc_headless = {
+        {"Headless", "无屏模式", "画面なし"},
+        (const localize_text_t[]){
+            {"Off", "关闭", "無効"},
+            {"On", "打开", "有効"},
+        },
+        misc_headless_t ::misc_headless_off,
+        misc_headless_t ::misc_headless_max};
+
+    // グラフ1ドットあたりの時間。graph_data_t::tier_t と同じ並び
+    config_property_localize_enum_t<misc_graphspan_t> misc_graphspan = {
+        {"Graph Span", "曲线跨度", "グラフ範囲"},
+        (const localize_text_t[]){
+            {"Live", "实时", "ライブ"},
+            {"1 sec/dot", "1秒/点", "1秒/点"},
+            {"1 min/dot", "1分/点", "1分/点"},
+        },
+        misc_graphspan_t ::misc_graphspan_live,
+        misc_graphspan_t ::misc_graphspan_max};
+
+    // 熱画像の拡大方法。Bicubic はフレーム到着時に拡大した画像を保持する
+    config_property_localize_enum_t<misc_upscale_t> misc_upscale = {
+        {"Upscale", "放大方式", "拡大方式"},
+        (const localize_text_t[]){
+            {"Bilinear", "双线性", "バイリニア"},
+            {"Bicubic", "双三次", "バイキュービック"},
+        },
+        misc_upscale_t ::misc_upscale_bilinear,
+        misc_upscale_t ::misc_upscale_max};
+
+    // 画面の帯の描画を APP_CPU の補助タスクと分担する
+    config_property_localize_enum_t<misc_dualcore_t> misc_dualcore = {
+        {"Dual Core Draw", "双核绘制", "2コア描画"},
+        (const localize_text_t[]){
+            {"Off", "关闭", "無効"},
+            {"On", "打开", "有効"},
+        },
+        misc_dualcore_t ::misc_dualcore_off,
+        misc_dualcore_t ::misc_dualcore_max};
+
+    // 描画バッファの色深度。8bit (RGB332) では同じメモリで2倍の行数を描き、
+    // 画面への転送時とJPEGエンコード時に16bitへ展開する
+    config_property_localize_enum_t<misc_drawbuf_t> misc_drawbuf = {
+        {"Draw Buffer", "绘制缓冲", "描画バッファ"},
+        (const localize_text_t[]){
+            {"16bit", "16位", "16bit"},
+            {"8bit", "8位", "8bit"},
+        },
+        misc_drawbuf_t ::misc_drawbuf_16bit,
+        misc_drawbuf_t ::misc_drawbuf_max};
+
     config_property_localize_enum_t<misc_color_t> misc_color = {
         {"Color", "色样", "色"},
         (const localize_text_t[]){
@@ -1271,6 +1790,10 @@ struct config_param_t {
     // bool net_webserver = false;
     // uint8_t misc_rotation = 1;
 
+    roi_rect_t roi_rect[roi_engine_t::roi_max];
+    // 設定画面のアラーム (alarm_mode 等) に追加して判定するルール
+    alarm_rule_t alarm_rules[alarm_engine_t::rule_max];
+
     bool in_config_mode     = false;
     uint8_t in_pause_state  = 0;
     bool in_rangehold_state = false;
@@ -1285,11 +1808,29 @@ struct draw_param_t : public config_param_t {
     void setColorTable(size_t idx);
     bool update(int frameindex);
     bool range_update(void);
+    bool updateColorLut(void);
 
     const m5gfx::IFont* font;
     const framedata_t* frame;
+    // 低レート時の表示補間用。直前のフレームと frame を frame_blend/256
+    // の比率で混合して表示する (256 で frame のみ)
+    const framedata_t* prev_frame;
+    uint16_t frame_blend = 256;
     const uint16_t* color_map = color_map_table[0];
+    // 温度値から表示色 (バイトスワップ済み RGB565) を引く変換テーブル。
+    // color_lut_scale で求めた位置で引く。
+    // 表示範囲 (modify_count) かパレットが変わった時だけ作り直す
+    static constexpr const size_t color_lut_len = 1024;
+    uint16_t color_lut[color_lut_len];
+    color_lut_scale_t color_lut_scale;
+    // 8bit 描画バッファ用の RGB332 の変換テーブル。
+    // 階調の段差を抑えるため 2x2 の組織的ディザの位置ごとに持つ
+    uint8_t color_lut8[4][color_lut_len];
+    inline uint32_t getColorIndex(int32_t raw) const {
+        return color_lut_scale.getIndex(raw);
+    }
     graph_data_t graph_data;
+    frame_recorder_t frame_recorder;
     // static constexpr const uint16_t graph_temp_len = 240;
     // uint16_t* graph_temp_arrays[4] = { nullptr, };
     int32_t temp_diff;
@@ -1297,6 +1838,22 @@ struct draw_param_t : public config_param_t {
     uint8_t update_count      = 0;
     uint8_t modify_count      = 0;
     uint32_t draw_count       = 0;
+    // 変化ありと判定したフレームの数、およびボタン操作の回数
+    volatile uint32_t scene_change_count = 0;
+    volatile uint8_t input_count         = 0;
+    // 処理段ごとの CPU 使用時間
+    enum busy_stage_t {
+        busy_frame,   // loop: フレーム合成・統計・アラーム判定
+        busy_ui,      // drawTask: UI の更新
+        busy_render,  // drawTask: 描画と画面への転送
+        busy_stage_max,
+    };
+    busy_meter_t busy_meter[busy_stage_max];
+    // 省電力制御で更新レートとクロックを下げている間 true
+    volatile bool power_idle = false;
+    // フレーム処理で判定したアラーム状態
+    volatile bool alarm_active          = false;
+    volatile uint32_t alarm_active_mask = 0;
     int8_t battery_state;
     int8_t battery_level;
     uint8_t font_height     = 8;
@@ -1325,10 +1882,29 @@ struct draw_param_t : public config_param_t {
     std::string cloud_url;
     IPAddress cloud_ip;
 
+    enum still_state_t {
+        still_none,
+        still_capturing,
+        still_ready,
+        still_error,
+    };
+    // 複数フレーム積算による静止画撮影 (Web APIから要求する)。
+    // 要求側は still_request (積算フレーム数) だけを書き、still_state は
+    // 要求を受け付けた loop() だけが書く。still_request が0でない間は
+    // 要求の受付待ちなので撮影中として扱う
+    volatile uint8_t still_request     = 0;
+    volatile still_state_t still_state = still_none;
+    const framedata_t* still_frame     = nullptr;
+
    protected:
     const framedata_t* _frame_array;
     uint8_t _prev_frameindex;
+    uint32_t _frame_msec   = 0;  // 最新フレームの到着時刻
+    uint32_t _frame_period = 0;  // フレーム到着間隔の平滑値 (msec)
 
     value_smooth_t _lowest_value;
     value_smooth_t _highest_value;
+
+    const uint16_t* _color_lut_src = nullptr;
+    uint8_t _color_lut_modify      = 0;
 };
@@ -0,0 +1,85 @@
+//! Copyright (c) M5Stack. All rights reserved.
+//! Licensed under the MIT license.
+//! See LICENSE file in the project root for full license information.
+
+#pragma once
+
+#include <cstdint>
+
+// 長い送信間隔向けの間欠動作スケジューラ。
+// 時刻は clock_source_t::now() (秒) から得るため、ホスト上では擬似時計を
+// 与えてスケジュールを確認できる。
+//
+//   slot - warmup_sec より前     : action_sleep   (getSleepSeconds 秒眠る)
+//   slot - warmup_sec から slot   : action_warmup  (センサとWiFiを準備する)
+//   slot から slot + timeout_sec  : action_upload  (撮影結果を送信する)
+//   それ以降                      : action_timeout (送信を諦める)
+//
+// 送信を終えたら (または諦めたら) complete() を呼び、次の送信時刻へ進める。
+template <class clock_source_t>
+class duty_cycle_scheduler_t {
+   public:
+    enum action_t {
+        action_sleep,
+        action_warmup,
+        action_upload,
+        action_timeout,
+    };
+
+    clock_source_t clock;
+
+    void setup(uint32_t interval_sec, uint32_t warmup_sec,
+               uint32_t timeout_sec) {
+        if (_interval_sec != interval_sec) {
+            _interval_sec = interval_sec;
+            _slot         = 0;
+        }
+        _warmup_sec  = warmup_sec;
+        _timeout_sec = timeout_sec;
+    }
+
+    action_t update(void) {
+        uint32_t now = clock.now();
+        if (_slot == 0) {
+            schedule(now);
+        }
+        if (now + _warmup_sec < _slot) {
+            _sleep_sec = _slot - _warmup_sec - now;
+            return action_sleep;
+        }
+        _sleep_sec = 0;
+        if (now < _slot) {
+            return action_warmup;
+        }
+        if (now < _slot + _timeout_sec) {
+            return action_upload;
+        }
+        return action_timeout;
+    }
+
+    // 直前の update が action_sleep の場合に眠ってよい秒数
+    uint32_t getSleepSeconds(void) const {
+        return _sleep_sec;
+    }
+
+    // 次の送信予定時刻 (interval_sec の倍数)
+    uint32_t getSlot(void) const {
+        return _slot;
+    }
+
+    void complete(void) {
+        schedule(clock.now());
+    }
+
+   private:
+    // now より後で最初の interval_sec の倍数を次の送信時刻とする
+    void schedule(uint32_t now) {
+        _slot = (now / _interval_sec + 1) * _interval_sec;
+    }
+
+    uint32_t _interval_sec = 0;
+    uint32_t _warmup_sec   = 0;
+    uint32_t _timeout_sec  = 0;
+    uint32_t _slot         = 0;
+    uint32_t _sleep_sec    = 0;
+};
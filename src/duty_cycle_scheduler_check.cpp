@@ -0,0 +1,139 @@
+//! Copyright (c) M5Stack. All rights reserved.
+//! Licensed under the MIT license.
+//! See LICENSE file in the project root for full license information.
+
+// duty_cycle_scheduler_t をホスト上で擬似時計を使って確認する。
+// ファームウェアのビルドでは何も生成しない。ホストでの実行方法:
+//   g++ -std=c++11 -Wall src/duty_cycle_scheduler_check.cpp && ./a.out
+#ifndef ARDUINO
+
+#include <cstdio>
+
+#include "duty_cycle_scheduler.hpp"
+
+namespace {
+
+struct fake_clock_t {
+    uint32_t sec = 0;
+    uint32_t now(void) const {
+        return sec;
+    }
+};
+
+typedef duty_cycle_scheduler_t<fake_clock_t> scheduler_t;
+
+int failure_count = 0;
+
+void expect(bool ok, const char* what, int line) {
+    if (!ok) {
+        printf("line %d: %s\n", line, what);
+        ++failure_count;
+    }
+}
+#define EXPECT(cond) expect((cond), #cond, __LINE__)
+
+// interval 600秒, warmup 20秒, timeout 30秒 で送信時刻 1200 の前後を確認する
+void checkBoundaries(void) {
+    scheduler_t s;
+    s.setup(600, 20, 30);
+    s.clock.sec = 1000;
+    EXPECT(s.update() == scheduler_t::action_sleep);
+    EXPECT(s.getSlot() == 1200);
+    EXPECT(s.getSleepSeconds() == 180);
+
+    s.clock.sec = 1179;
+    EXPECT(s.update() == scheduler_t::action_sleep);
+    EXPECT(s.getSleepSeconds() == 1);
+
+    s.clock.sec = 1180;
+    EXPECT(s.update() == scheduler_t::action_warmup);
+    EXPECT(s.getSleepSeconds() == 0);
+
+    s.clock.sec = 1199;
+    EXPECT(s.update() == scheduler_t::action_warmup);
+
+    s.clock.sec = 1200;
+    EXPECT(s.update() == scheduler_t::action_upload);
+
+    s.clock.sec = 1229;
+    EXPECT(s.update() == scheduler_t::action_upload);
+
+    s.clock.sec = 1230;
+    EXPECT(s.update() == scheduler_t::action_timeout);
+    EXPECT(s.getSlot() == 1200);
+}
+
+// 送信完了後は次の倍数へ進む。遅れて完了した場合も過去の時刻は選ばない
+void checkComplete(void) {
+    scheduler_t s;
+    s.setup(600, 20, 30);
+    s.clock.sec = 1205;
+    EXPECT(s.update() == scheduler_t::action_sleep);
+    EXPECT(s.getSlot() == 1800);
+
+    s.clock.sec = 1800;
+    EXPECT(s.update() == scheduler_t::action_upload);
+    s.clock.sec = 1810;
+    s.complete();
+    EXPECT(s.getSlot() == 2400);
+    EXPECT(s.update() == scheduler_t::action_sleep);
+    EXPECT(s.getSleepSeconds() == 2400 - 20 - 1810);
+
+    s.clock.sec = 4000;
+    EXPECT(s.update() == scheduler_t::action_timeout);
+    s.complete();
+    EXPECT(s.getSlot() == 4200);
+}
+
+// warmup が interval より長い場合は送信時刻まで常に準備状態になる
+void checkLongWarmup(void) {
+    scheduler_t s;
+    s.setup(10, 60, 5);
+    s.clock.sec = 3;
+    EXPECT(s.update() == scheduler_t::action_warmup);
+    EXPECT(s.getSlot() == 10);
+    EXPECT(s.getSleepSeconds() == 0);
+}
+
+// interval を変えると送信時刻を新しい倍数で決め直す。同じ値なら維持する
+void checkIntervalChange(void) {
+    scheduler_t s;
+    s.setup(600, 20, 30);
+    s.clock.sec = 1000;
+    s.update();
+    EXPECT(s.getSlot() == 1200);
+
+    s.setup(600, 10, 30);
+    EXPECT(s.getSlot() == 1200);
+    s.clock.sec = 1185;
+    EXPECT(s.update() == scheduler_t::action_sleep);
+    EXPECT(s.getSleepSeconds() == 5);
+
+    s.setup(300, 10, 30);
+    EXPECT(s.update() == scheduler_t::action_sleep);
+    EXPECT(s.getSlot() == 1200);
+
+    s.clock.sec = 1201;
+    EXPECT(s.update() == scheduler_t::action_upload);
+    s.setup(60, 10, 30);
+    EXPECT(s.update() == scheduler_t::action_sleep);
+    EXPECT(s.getSlot() == 1260);
+    EXPECT(s.getSleepSeconds() == 49);
+}
+
+}  // namespace
+
+int main(void) {
+    checkBoundaries();
+    checkComplete();
+    checkLongWarmup();
+    checkIntervalChange();
+    if (failure_count) {
+        printf("duty_cycle_scheduler: %d failure(s)\n", failure_count);
+        return 1;
+    }
+    printf("duty_cycle_scheduler: ok\n");
+    return 0;
+}
+
+#endif
@@ -0,0 +1,140 @@
+//! Copyright (c) M5Stack. All rights reserved.
+//! Licensed under the MIT license.
+//! See LICENSE file in the project root for full license information.
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// サーモ画像の拡大補間と、温度値から表示色の変換テーブルへの対応付け。
+// image_ui_t とホスト上の確認 (image_interp_check.cpp) で共用する。
+// 補間はセンサ画素ごとの変換テーブル上の位置 (level) に対して行う
+
+// 温度値と変換テーブル上の位置の対応。
+// 表示範囲の下限との差を16倍し、表示範囲全体が len 未満に収まるよう
+// shift で量子化する
+struct color_lut_scale_t {
+    int32_t base  = 0;
+    int32_t max   = 0;  // 表示範囲の上限に対応する位置
+    int32_t diff  = 1;
+    uint8_t shift = 0;
+
+    void setup(int32_t lower, int32_t diff_, size_t len) {
+        if (diff_ < 1) diff_ = 1;
+        uint8_t s = 0;
+        while (((diff_ << 4) >> s) >= (int32_t)len) {
+            ++s;
+        }
+        base  = lower;
+        diff  = diff_;
+        shift = s;
+        max   = (diff_ << 4) >> s;
+    }
+
+    inline uint32_t getIndex(int32_t raw) const {
+        int32_t i = ((raw - base) << 4) >> shift;
+        return (i < 0) ? 0 : (i > max) ? max : i;
+    }
+
+    // 変換テーブルの位置 i に割り当てるパレットの番号 (0~255)
+    uint8_t getPaletteIndex(size_t i) const {
+        int32_t v = ((int32_t)(i << shift) << 4) / diff;
+        return (v > 255) ? 255 : v;
+    }
+};
+
+// 描画先の各列 (行) が参照するセンサ画素の位置と、次の画素の重み (0~256)
+// cubic は Catmull-Rom 補間の4点分の重み (合計256)
+struct interp_axis_t {
+    std::vector<uint8_t> src;
+    std::vector<uint16_t> weight;
+    std::vector<int16_t> cubic;
+
+    void build(int32_t len, int32_t cells) {
+        src.resize(len);
+        weight.resize(len);
+        cubic.resize(len * 4);
+        int32_t p1 = 0;
+        for (int32_t c = 1; c <= cells; ++c) {
+            int32_t p0  = p1;
+            p1          = (c * len) / cells;
+            int32_t box = p1 - p0;
+            for (int32_t p = p0; p < p1; ++p) {
+                src[p]    = c - 1;
+                weight[p] = ((p - p0) << 8) / box;
+
+                float t  = weight[p] / 256.0f;
+                float t2 = t * t;
+                float t3 = t2 * t;
+                auto k   = &cubic[p * 4];
+                k[0]     = lroundf((-t + 2 * t2 - t3) * 128);
+                k[2]     = lroundf((t + 4 * t2 - 3 * t3) * 128);
+                k[3]     = lroundf((t3 - t2) * 128);
+                k[1]     = 256 - (k[0] + k[2] + k[3]);
+            }
+        }
+    }
+};
+
+// センサ1行分を横方向に線形補間する (結果は256倍の値)
+inline void interpolateLinearRow(const uint16_t* level,
+                                 const interp_axis_t& cols, int32_t w,
+                                 uint32_t* dst) {
+    for (int32_t x = 0; x < w; ++x) {
+        auto src   = &level[cols.src[x]];
+        int32_t wx = cols.weight[x];
+        dst[x]     = src[0] * (256 - wx) + src[1] * wx;
+    }
+}
+
+// 横方向に補間した上下2行を縦方向に線形補間し、変換テーブル上の位置にする
+inline uint32_t interpolateLinear(uint32_t top, uint32_t bottom, int32_t wy) {
+    return (top * (256 - wy) + bottom * wy) >> 16;
+}
+
+// センサ1行 (width 画素) を横方向に Catmull-Rom 補間する
+// (両端は外側へ複製する)
+template <size_t width>
+inline void interpolateCubicRow(const uint16_t* level,
+                                const interp_axis_t& cols, int32_t w,
+                                int16_t* dst) {
+    uint16_t row[width + 2];
+    memcpy(&row[1], level, width * sizeof(row[0]));
+    row[0]         = level[0];
+    row[width + 1] = level[width - 1];
+    for (int32_t x = 0; x < w; ++x) {
+        auto src = &row[cols.src[x]];
+        auto k   = &cols.cubic[x * 4];
+        dst[x]   = (src[0] * k[0] + src[1] * k[1] + src[2] * k[2] +
+                  src[3] * k[3] + 128) >>
+                 8;
+    }
+}
+
+// 横方向に補間済みの全行 (hrows) を縦方向に Catmull-Rom 補間し、
+// 0 ~ lmax に収めた変換テーブル上の位置にする
+inline void interpolateCubicImage(const int16_t* hrows, size_t height,
+                                  const interp_axis_t& rows, int32_t w,
+                                  int32_t h, int32_t lmax, uint16_t* dst) {
+    for (int32_t y = 0; y < h; ++y) {
+        int32_t fy = rows.src[y];
+        int32_t f0 = fy ? fy - 1 : 0;
+        int32_t f3 = (fy + 2 < (int32_t)height) ? fy + 2 : fy + 1;
+        auto k     = &rows.cubic[y * 4];
+        auto r0    = &hrows[f0 * w];
+        auto r1    = &hrows[fy * w];
+        auto r2    = &hrows[(fy + 1) * w];
+        auto r3    = &hrows[f3 * w];
+        auto d     = &dst[y * w];
+        for (int32_t x = 0; x < w; ++x) {
+            int32_t v = (r0[x] * k[0] + r1[x] * k[1] + r2[x] * k[2] +
+                         r3[x] * k[3] + 128) >>
+                        8;
+            d[x] = (v < 0) ? 0 : (v > lmax) ? lmax : v;
+        }
+    }
+}
@@ -0,0 +1,219 @@
+//! Copyright (c) M5Stack. All rights reserved.
+//! Licensed under the MIT license.
+//! See LICENSE file in the project root for full license information.
+
+// image_ui_t の補間 (image_interp.hpp) をホスト上で確認する。
+// 以前の描画処理 (枠ごとの固定小数点の補間と画素ごとの除算) を基準とし、
+// いくつかの表示サイズ・表示範囲・フレームで、画素ごとのパレット番号の差を
+// 求める。ファームウェアのビルドでは何も生成しない。ホストでの実行方法:
+//   g++ -std=c++11 -O2 -Wall src/image_interp_check.cpp && ./a.out
+#ifndef ARDUINO
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "image_interp.hpp"
+
+namespace {
+
+static constexpr const int32_t frame_width   = 32;
+static constexpr const int32_t frame_height  = 24;
+static constexpr const size_t color_lut_len  = 1024;
+// 許容範囲: パレット番号で3段まで。差は次の2つの丸めの違いから生じる
+//  - 補間表の8bitの重みと、以前の枠ごとの逆数の切り捨て (単独で2段まで)
+//  - 温度値を変換テーブルの位置に量子化してから補間すること
+// 両者を合わせても、乱数の種を変えて測った最大値は3段だった
+static constexpr const int32_t max_step_diff = 3;
+
+// 以前の描画処理。温度値をパレット番号 (0~255) にしてから、センサ画素の
+// 間の枠ごとに縦横の線形補間を行う
+void drawReference(const uint16_t* raw, int32_t lower, int32_t temp_diff,
+                   int32_t w, int32_t h, uint8_t* dst) {
+    auto level = [=](size_t i) -> int32_t {
+        int32_t v = ((raw[i] - lower) << 8) / temp_diff;
+        return (v < 0) ? 0 : (v > 255) ? 255 : v;
+    };
+    int32_t y1 = 0;
+    for (int32_t fy = 1; fy < frame_height; ++fy) {
+        int32_t y0        = y1;
+        y1                = (fy * h) / (frame_height - 1);
+        int32_t boxHeight = y1 - y0;
+        if (boxHeight == 0) continue;
+
+        int32_t v0;
+        int32_t v1 = level((fy - 1) * frame_width);
+        int32_t v2;
+        int32_t v3 = level((fy)*frame_width);
+        int32_t x1 = 0;
+        for (int32_t fx = 1; fx < frame_width; ++fx) {
+            int32_t x0       = x1;
+            x1               = (fx * w) / (frame_width - 1);
+            int32_t boxWidth = x1 - x0;
+            v0               = v1;
+            v1               = level(fx + (fy - 1) * frame_width);
+            v2               = v3;
+            v3               = level(fx + (fy)*frame_width);
+            if (boxWidth == 0) continue;
+            uint32_t mul = (1 << 16) / (boxWidth * boxHeight);
+            for (int32_t by = 0; by < boxHeight; ++by) {
+                uint32_t v02 = (v0 * (boxHeight - by) + v2 * by) * mul;
+                uint32_t v13 = (v1 * (boxHeight - by) + v3 * by) * mul;
+                auto img_buf = &dst[x0 + (y0 + by) * w];
+                for (int32_t bx = 0; bx < boxWidth; ++bx) {
+                    img_buf[bx] = (v02 * (boxWidth - bx) + v13 * bx) >> 16;
+                }
+            }
+        }
+    }
+}
+
+// 現在の描画処理 (image_ui_t::updateLevel / draw の線形補間と同じ手順)
+void drawLinear(const uint16_t* raw, int32_t lower, int32_t temp_diff,
+                int32_t w, int32_t h, uint8_t* dst) {
+    color_lut_scale_t scale;
+    scale.setup(lower, temp_diff, color_lut_len);
+    interp_axis_t cols;
+    interp_axis_t rows;
+    cols.build(w, frame_width - 1);
+    rows.build(h, frame_height - 1);
+    uint16_t level[frame_width * frame_height];
+    for (int32_t i = 0; i < frame_width * frame_height; ++i) {
+        level[i] = scale.getIndex(raw[i]);
+    }
+    std::vector<uint32_t> top(w);
+    std::vector<uint32_t> bottom(w);
+    for (int32_t y = 0; y < h; ++y) {
+        int32_t fy = rows.src[y];
+        int32_t wy = rows.weight[y];
+        interpolateLinearRow(&level[fy * frame_width], cols, w, top.data());
+        interpolateLinearRow(&level[(fy + 1) * frame_width], cols, w,
+                             bottom.data());
+        for (int32_t x = 0; x < w; ++x) {
+            uint32_t v     = interpolateLinear(top[x], bottom[x], wy);
+            dst[x + y * w] = scale.getPaletteIndex(v);
+        }
+    }
+}
+
+struct layout_t {
+    int32_t w;
+    int32_t h;
+};
+
+// 表示範囲 (raw値)。以前の処理と同じく temp_diff は上限 - 下限 + 1
+struct range_t {
+    int32_t lower;
+    int32_t temp_diff;
+};
+
+enum pattern_t {
+    pattern_noise,     // 表示範囲の中で一様な乱数
+    pattern_gradient,  // 斜めの階調
+    pattern_spot,      // 低温の背景に1点の高温
+    pattern_clip,      // 表示範囲の外側の値を含む
+    pattern_max,
+};
+static constexpr const char* pattern_name[] = {"noise", "gradient", "spot",
+                                               "clip"};
+
+std::mt19937 rng(1);
+
+void makeFrame(pattern_t pattern, const range_t& range, uint16_t* raw) {
+    int32_t lo = range.lower;
+    int32_t hi = range.lower + range.temp_diff - 1;
+    std::uniform_int_distribution<int32_t> any(lo, hi);
+    std::uniform_int_distribution<int32_t> wide(lo - range.temp_diff,
+                                                hi + range.temp_diff);
+    for (int32_t y = 0; y < frame_height; ++y) {
+        for (int32_t x = 0; x < frame_width; ++x) {
+            int32_t v = lo;
+            switch (pattern) {
+                case pattern_gradient:
+                    v = lo + (range.temp_diff - 1) * (x + y) /
+                                 (frame_width + frame_height - 2);
+                    break;
+                case pattern_spot:
+                    v = (x == 13 && y == 9) ? hi : lo + range.temp_diff / 8;
+                    break;
+                case pattern_clip:
+                    v = wide(rng);
+                    break;
+                default:
+                    v = any(rng);
+                    break;
+            }
+            if (v < 0) v = 0;
+            if (v > UINT16_MAX) v = UINT16_MAX;
+            raw[x + y * frame_width] = v;
+        }
+    }
+}
+
+int failure_count = 0;
+
+}  // namespace
+
+int main(void) {
+    // 画面全体・分割表示・縦長・センサ画素と同数など
+    static const layout_t layouts[] = {
+        {31, 23}, {64, 48}, {135, 101}, {240, 135}, {180, 135}, {97, 200},
+        {320, 240},
+    };
+    // 1℃幅 / 10℃幅 / 100℃幅 (変換テーブルの量子化あり) / 最大範囲
+    static const range_t ranges[] = {
+        {(64 + 20) * 128, 128 + 1},
+        {(64 + 20) * 128, 1280 + 1},
+        {64 * 128, 12800 + 1},
+        {0, 65535},
+    };
+    static constexpr const int frames = 4;
+
+    printf("  layout   range  pattern    max  mean   exact\n");
+    std::vector<uint8_t> ref;
+    std::vector<uint8_t> img;
+    for (auto& layout : layouts) {
+        size_t len = layout.w * layout.h;
+        ref.resize(len);
+        img.resize(len);
+        for (auto& range : ranges) {
+            for (int p = 0; p < pattern_max; ++p) {
+                int32_t worst = 0;
+                uint64_t sum  = 0;
+                size_t exact  = 0;
+                for (int f = 0; f < frames; ++f) {
+                    uint16_t raw[frame_width * frame_height];
+                    makeFrame((pattern_t)p, range, raw);
+                    drawReference(raw, range.lower, range.temp_diff, layout.w,
+                                  layout.h, ref.data());
+                    drawLinear(raw, range.lower, range.temp_diff, layout.w,
+                               layout.h, img.data());
+                    for (size_t i = 0; i < len; ++i) {
+                        int32_t d = abs(ref[i] - img[i]);
+                        if (worst < d) worst = d;
+                        sum += d;
+                        exact += (d == 0);
+                    }
+                }
+                printf("%3dx%-3d  %6d  %-8s  %4d  %4.2f  %5.1f%%\n", layout.w,
+                       layout.h, range.temp_diff, pattern_name[p], worst,
+                       (double)sum / (len * frames),
+                       100.0 * exact / (len * frames));
+                if (worst > max_step_diff) {
+                    printf("  difference above %d palette steps\n",
+                           max_step_diff);
+                    ++failure_count;
+                }
+            }
+        }
+    }
+    if (failure_count) {
+        printf("image_interp: %d failure(s)\n", failure_count);
+        return 1;
+    }
+    printf("image_interp: ok\n");
+    return 0;
+}
+
+#endif
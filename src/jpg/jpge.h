@@ -79,6 +79,10 @@ class jpeg_encoder {
     bool process_scanline(const void *pScanline);
     bool process_scanline565(const void *pScanline);
     void process_mcu_row();
+    // Number of scanlines buffered for one process_mcu_row() call.
+    int get_mcu_lines() const {
+        return m_mcu_y;
+    }
 
     // Deinitializes the compressor, freeing any allocated memory. May be called
     // at any time.
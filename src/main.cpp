@@ -19,6 +19,7 @@
 #include <lgfx/utility/lgfx_qrcode.h>
 
 #include "common_header.h"
+#include "duty_cycle_scheduler.hpp"
 #include "screenshot_streamer.hpp"
 #include "jpg/jpge.h"
 
@@ -73,6 +74,14 @@ framedata_t framedata[framedata_len];
 
 volatile int idx_recv = -1;
 
+// 描画タスク。新しいフレームの到着やボタン操作を通知して直ちに描画させる
+static TaskHandle_t draw_task_handle = nullptr;
+static inline void notifyDrawTask(void) {
+    if (draw_task_handle) {
+        xTaskNotifyGive(draw_task_handle);
+    }
+}
+
 static int smooth_move(int dst, int src) {
     return (dst == src) ? dst : ((dst + src + (src < dst ? 1 : 0)) >> 1);
     // return (dst == src) ? dst : ((dst * 3 + src * 5 + (src < dst ? 5 : 0)) >>
@@ -212,6 +221,9 @@ static constexpr const char KEY_SENS_REFRESHRATE[] = "refreshrate";
 static constexpr const char KEY_SENS_NOISEFILTER[] = "noisefilter";
 static constexpr const char KEY_SENS_MONITORAREA[] = "monitorarea";
 static constexpr const char KEY_SENS_EMISSIVITY[]  = "emissivity";
+static constexpr const char KEY_SENS_SCENEGATE[]   = "scenegate";
+static constexpr const char KEY_SENS_SCENESENS[]   = "scenesens";
+static constexpr const char KEY_SENS_REFLECTED[]   = "reflected";
 static constexpr const char KEY_RANGE_AUTOSWITCH[] = "range_auto";
 static constexpr const char KEY_RANGE_UPPER[]      = "range_upper";
 static constexpr const char KEY_RANGE_LOWER[]      = "range_lower";
@@ -219,6 +231,7 @@ static constexpr const char KEY_NET_RUNNING_MODE[] = "net_running";
 static constexpr const char KEY_NET_JPGQUALITY[]   = "jpg_quality";
 static constexpr const char KEY_CLOUD_UPLOAD[]     = "upload_ena";
 static constexpr const char KEY_CLOUD_INTERVAL[]   = "upload_int";
+static constexpr const char KEY_CLOUD_DUTYCYCLE[]  = "upload_duty";
 static constexpr const char KEY_CLOUD_TOKEN[]      = "ezdata_token";
 static constexpr const char KEY_NET_TIMEZONE[]     = "timezone";
 static constexpr const char KEY_MISC_CPUSPEED[]    = "cpuspeed";
@@ -228,6 +241,14 @@ static constexpr const char KEY_MISC_LANGUAGE[]    = "language";
 static constexpr const char KEY_MISC_LAYOUT[]      = "layout";
 static constexpr const char KEY_MISC_COLOR[]       = "color";
 static constexpr const char KEY_MISC_POINTER[]     = "pointer";
+static constexpr const char KEY_MISC_GRAPHSPAN[]   = "graphspan";
+static constexpr const char KEY_MISC_UPSCALE[]     = "upscale";
+static constexpr const char KEY_MISC_DUALCORE[]    = "dualcore";
+static constexpr const char KEY_MISC_DRAWBUF[]     = "drawbuf";
+static constexpr const char KEY_MISC_HEADLESS[]    = "headless";
+static constexpr const char KEY_MISC_GOVERNOR[]    = "governor";
+static constexpr const char KEY_ROI_RECT[]         = "roi_rect";
+static constexpr const char KEY_ALARM_RULES[]      = "alm_rules";
 // static constexpr const char KEY_MISC_ROTATION[]     = "msc_rotation";
 
 std::string convert(const std::string& src) {
@@ -255,6 +276,9 @@ void config_param_t::saveNvs(void) {
     pref.putUChar(KEY_SENS_NOISEFILTER, sens_noisefilter);
     pref.putUChar(KEY_SENS_MONITORAREA, sens_monitorarea);
     pref.putUChar(KEY_SENS_EMISSIVITY, sens_emissivity);
+    pref.putChar(KEY_SENS_REFLECTED, sens_reflected);
+    pref.putUChar(KEY_SENS_SCENEGATE, sens_scenegate);
+    pref.putUChar(KEY_SENS_SCENESENS, sens_scenesens);
     pref.putUChar(KEY_RANGE_AUTOSWITCH, range_autoswitch);
     pref.putUShort(KEY_RANGE_UPPER, range_temp_upper);
     pref.putUShort(KEY_RANGE_LOWER, range_temp_lower);
@@ -265,10 +289,19 @@ void config_param_t::saveNvs(void) {
     pref.putInt(KEY_NET_TIMEZONE, oncloud_timezone_sec);
     // pref.putBool(  KEY_CLOUD_UPLOAD     , cloud_upload         );
     pref.putUChar(KEY_CLOUD_INTERVAL, cloud_interval);
+    pref.putUChar(KEY_CLOUD_DUTYCYCLE, cloud_dutycycle);
     pref.putUChar(KEY_MISC_BRIGHTNESS, misc_brightness);
     pref.putUChar(KEY_MISC_VOLUME, misc_volume);
     pref.putUChar(KEY_MISC_LANGUAGE, misc_language);
     pref.putUChar(KEY_MISC_POINTER, misc_pointer);
+    pref.putUChar(KEY_MISC_GRAPHSPAN, misc_graphspan);
+    pref.putUChar(KEY_MISC_UPSCALE, misc_upscale);
+    pref.putUChar(KEY_MISC_DUALCORE, misc_dualcore);
+    pref.putUChar(KEY_MISC_DRAWBUF, misc_drawbuf);
+    pref.putUChar(KEY_MISC_HEADLESS, misc_headless);
+    pref.putUChar(KEY_MISC_GOVERNOR, misc_governor);
+    pref.putBytes(KEY_ROI_RECT, roi_rect, sizeof(roi_rect));
+    pref.putBytes(KEY_ALARM_RULES, alarm_rules, sizeof(alarm_rules));
     pref.putUChar(KEY_MISC_LAYOUT, misc_layout);
     pref.putUChar(KEY_MISC_COLOR, misc_color);
     pref.putString(KEY_CLOUD_TOKEN, cloud_token.c_str());
@@ -298,6 +331,11 @@ void config_param_t::loadNvs(void) {
         sens_monitorarea = (sens_monitorarea_t)pref.getUChar(
             KEY_SENS_MONITORAREA, sens_monitorarea);
         sens_emissivity  = pref.getUChar(KEY_SENS_EMISSIVITY, sens_emissivity);
+        sens_reflected   = pref.getChar(KEY_SENS_REFLECTED, sens_reflected);
+        sens_scenegate   = (sens_scenegate_t)pref.getUChar(KEY_SENS_SCENEGATE,
+                                                         sens_scenegate);
+        sens_scenesens   = (sens_scenesens_t)pref.getUChar(KEY_SENS_SCENESENS,
+                                                         sens_scenesens);
         range_autoswitch = (range_autoswitch_t)pref.getUChar(
             KEY_RANGE_AUTOSWITCH, range_autoswitch);
         range_temp_upper = pref.getUShort(KEY_RANGE_UPPER, range_temp_upper);
@@ -320,12 +358,28 @@ void config_param_t::loadNvs(void) {
             (misc_language_t)pref.getUChar(KEY_MISC_LANGUAGE, misc_language);
         misc_pointer =
             (misc_pointer_t)pref.getUChar(KEY_MISC_POINTER, misc_pointer);
+        misc_graphspan = (misc_graphspan_t)pref.getUChar(KEY_MISC_GRAPHSPAN,
+                                                         misc_graphspan);
+        misc_upscale   = (misc_upscale_t)pref.getUChar(KEY_MISC_UPSCALE,
+                                                     misc_upscale);
+        misc_dualcore  = (misc_dualcore_t)pref.getUChar(KEY_MISC_DUALCORE,
+                                                       misc_dualcore);
+        misc_drawbuf   = (misc_drawbuf_t)pref.getUChar(KEY_MISC_DRAWBUF,
+                                                     misc_drawbuf);
+        misc_headless  = (misc_headless_t)pref.getUChar(KEY_MISC_HEADLESS,
+                                                       misc_headless);
+        misc_governor  = (misc_governor_t)pref.getUChar(KEY_MISC_GOVERNOR,
+                                                       misc_governor);
+        pref.getBytes(KEY_ROI_RECT, roi_rect, sizeof(roi_rect));
+        pref.getBytes(KEY_ALARM_RULES, alarm_rules, sizeof(alarm_rules));
         misc_layout = pref.getUChar(KEY_MISC_LAYOUT, misc_layout);
         misc_color  = (misc_color_t)pref.getUChar(KEY_MISC_COLOR, misc_color);
         // cloud_upload         = (cloud_upload_t)    pref.getUChar(
         // KEY_CLOUD_UPLOAD     , cloud_upload         );
         cloud_interval =
             (cloud_interval_t)pref.getUChar(KEY_CLOUD_INTERVAL, cloud_interval);
+        cloud_dutycycle = (cloud_dutycycle_t)pref.getUChar(KEY_CLOUD_DUTYCYCLE,
+                                                           cloud_dutycycle);
         cloud_token =
             pref.getString(KEY_CLOUD_TOKEN, cloud_token.c_str()).c_str();
         // net_ssid             = pref.getString(KEY_NET_SSID         ,
@@ -352,6 +406,9 @@ void config_param_t::loadDefault(void) {
     sens_noisefilter = sens_noisefilter_t::sens_noisefilter_medium;
     sens_monitorarea = sens_monitorarea_t::sens_monitorarea_30x24;
     sens_emissivity  = 98;
+    sens_reflected   = sens_reflected_auto;
+    sens_scenegate   = sens_scenegate_t::sens_scenegate_off;
+    sens_scenesens   = sens_scenesens_t::sens_scenesens_middle;
     range_autoswitch = range_autoswitch_t::range_autoswitch_on;
     range_temp_upper = (40 + 64) * 128;
     range_temp_lower = (20 + 64) * 128;
@@ -360,10 +417,19 @@ void config_param_t::loadDefault(void) {
     misc_language    = misc_language_t ::misc_language_en;
     net_jpg_quality  = 60;
     cloud_interval   = cloud_interval_t ::cloud_interval_30sec;
+    cloud_dutycycle  = cloud_dutycycle_t ::cloud_dutycycle_off;
     misc_layout      = 0;
     misc_color.setDefault();
-    misc_pointer = misc_pointer_t ::misc_pointer_pointtxt;
-    misc_volume  = misc_volume_t ::misc_volume_normal;
+    misc_pointer   = misc_pointer_t ::misc_pointer_pointtxt;
+    misc_graphspan = misc_graphspan_t ::misc_graphspan_live;
+    misc_upscale   = misc_upscale_t ::misc_upscale_bilinear;
+    misc_dualcore  = misc_dualcore_t ::misc_dualcore_off;
+    misc_drawbuf   = misc_drawbuf_t ::misc_drawbuf_16bit;
+    misc_headless  = misc_headless_t ::misc_headless_off;
+    misc_governor  = misc_governor_t ::misc_governor_off;
+    misc_volume    = misc_volume_t ::misc_volume_normal;
+    memset(roi_rect, 0, sizeof(roi_rect));
+    memset(alarm_rules, 0, sizeof(alarm_rules));
 }
 
 void config_param_t::setEmissivity(uint8_t emissivity) {
@@ -419,21 +485,350 @@ struct graph_filter_t {
 static graph_filter_t graph_filter[4];
 //*/
 
+void graph_history_t::fill(const uint16_t* temp) {
+    for (int i = 0; i < 4; ++i) {
+        if (temp_arrays[i] == nullptr) continue;
+        for (int j = 0; j < data_len; ++j) {
+            temp_arrays[i][j] = temp[i];
+        }
+    }
+    count = 0;
+    rebuild();
+}
+
+void graph_history_t::push(const uint16_t* temp) {
+    uint8_t idx = current_idx + 1;
+    for (int i = 0; i < 4; ++i) {
+        if (temp_arrays[i]) {
+            temp_arrays[i][idx] = temp[i];
+        }
+    }
+    current_idx = idx;
+    if (count < data_len) {
+        ++count;
+    }
+
+    // 範囲外に出たインデクスを先頭から外す
+    uint8_t expired = idx - _window;
+    if (_low_head != _low_tail && _low_queue[_low_head] == expired) {
+        ++_low_head;
+    }
+    if (_high_head != _high_tail && _high_queue[_high_head] == expired) {
+        ++_high_head;
+    }
+
+    // 新しい値より大きい (小さい) 値は今後最低 (最高) になり得ないので捨てる
+    const uint16_t* lows  = temp_arrays[framedata_t::lowest];
+    const uint16_t* highs = temp_arrays[framedata_t::highest];
+    while (_low_head != _low_tail &&
+           lows[_low_queue[(uint8_t)(_low_tail - 1)]] >= lows[idx]) {
+        --_low_tail;
+    }
+    _low_queue[_low_tail++] = idx;
+    while (_high_head != _high_tail &&
+           highs[_high_queue[(uint8_t)(_high_tail - 1)]] <= highs[idx]) {
+        --_high_tail;
+    }
+    _high_queue[_high_tail++] = idx;
+}
+
+void graph_history_t::applyWindow(void) {
+    if (_window != _request_window) {
+        _window = _request_window;
+        rebuild();
+    }
+}
+
+void graph_history_t::rebuild(void) {
+    _low_head  = 0;
+    _low_tail  = 0;
+    _high_head = 0;
+    _high_tail = 0;
+    const uint16_t* lows  = temp_arrays[framedata_t::lowest];
+    const uint16_t* highs = temp_arrays[framedata_t::highest];
+    uint8_t idx           = current_idx - _window;
+    for (int i = 0; i < _window; ++i) {
+        ++idx;
+        while (_low_head != _low_tail &&
+               lows[_low_queue[_low_tail - 1]] >= lows[idx]) {
+            --_low_tail;
+        }
+        _low_queue[_low_tail++] = idx;
+        while (_high_head != _high_tail &&
+               highs[_high_queue[_high_tail - 1]] <= highs[idx]) {
+            --_high_tail;
+        }
+        _high_queue[_high_tail++] = idx;
+    }
+}
+
+void graph_accum_t::add(const uint16_t* temp) {
+    if (count == 0) {
+        lowest      = temp[framedata_t::lowest];
+        highest     = temp[framedata_t::highest];
+        average_sum = 0;
+    } else {
+        if (lowest > temp[framedata_t::lowest]) {
+            lowest = temp[framedata_t::lowest];
+        }
+        if (highest < temp[framedata_t::highest]) {
+            highest = temp[framedata_t::highest];
+        }
+    }
+    average_sum += temp[framedata_t::average];
+    ++count;
+}
+
+bool graph_accum_t::take(uint16_t* temp) {
+    if (count == 0) {
+        return false;
+    }
+    temp[framedata_t::lowest]  = lowest;
+    temp[framedata_t::highest] = highest;
+    temp[framedata_t::average] = (average_sum + (count >> 1)) / count;
+    temp[framedata_t::center]  = temp[framedata_t::average];
+    count                      = 0;
+    return true;
+}
+
+void graph_data_t::setup(void) {
+    for (int t = 0; t < tier_max; ++t) {
+        for (int i = 0; i < 4; ++i) {
+            // 集約段の中心温度は表示しないので確保しない
+            if (t != tier_live && i == framedata_t::center) continue;
+            history[t].temp_arrays[i] = (uint16_t*)malloc(
+                graph_history_t::data_len * sizeof(uint16_t));
+        }
+    }
+}
+
+void graph_data_t::fill(const uint16_t* temp) {
+    for (int t = 0; t < tier_max; ++t) {
+        history[t].fill(temp);
+    }
+    _second_accum.count = 0;
+    _minute_accum.count = 0;
+    _minute_seconds     = 0;
+}
+
+void graph_data_t::push(const uint16_t* temp, uint32_t msec) {
+    for (int t = 0; t < tier_max; ++t) {
+        history[t].applyWindow();
+    }
+    history[tier_live].push(temp);
+
+    if (_second_accum.count == 0) {
+        _second_msec = msec;
+    }
+    _second_accum.add(temp);
+    if (msec - _second_msec < tier_period_msec[tier_second]) {
+        return;
+    }
+    uint16_t agg[4];
+    _second_accum.take(agg);
+    history[tier_second].push(agg);
+
+    _minute_accum.add(agg);
+    if (++_minute_seconds < tier_period_msec[tier_minute] /
+                                tier_period_msec[tier_second]) {
+        return;
+    }
+    _minute_seconds = 0;
+    _minute_accum.take(agg);
+    history[tier_minute].push(agg);
+}
+
+// 1画素あたりの最大ビット数 (Rice符号の上限16bit + エスケープ後の15bit)
+static constexpr const size_t recorder_escape_unary = 16;
+static constexpr const size_t recorder_escape_bits  = 15;
+static constexpr const size_t recorder_record_bytes =
+    (frame_width * frame_height *
+         (recorder_escape_unary + recorder_escape_bits) +
+     7) >>
+    3;
+
+bool frame_recorder_t::setup(void) {
+    _buffer = (uint8_t*)malloc(buffer_size);
+    clear();
+    return _buffer != nullptr;
+}
+
+void frame_recorder_t::clear(void) {
+    _record_head  = 0;
+    _record_count = 0;
+    _read_pos     = _write_pos;
+    _since_key    = 0;
+}
+
+void frame_recorder_t::evictGroup(void) {
+    // 最古のキーフレームから次のキーフレームの手前までをまとめて捨てる
+    do {
+        _record_head = (_record_head + 1) % record_max;
+        --_record_count;
+    } while (_record_count && !_records[_record_head].key);
+    _read_pos = _record_count ? _records[_record_head].pos : _write_pos;
+}
+
+void frame_recorder_t::record(const uint16_t* pixel_raw, uint32_t msec,
+                              bool trigger) {
+    if (_buffer == nullptr) {
+        return;
+    }
+    if (_rearm_request) {
+        _rearm_request = false;
+        clear();
+        _frozen = false;
+    }
+    bool rising   = trigger && !_prev_trigger;
+    _prev_trigger = trigger;
+    if (_frozen) {
+        return;
+    }
+
+    while (_record_count &&
+           (_record_count >= record_max ||
+            buffer_size - (_write_pos - _read_pos) < recorder_record_bytes)) {
+        evictGroup();
+    }
+    bool key = (_record_count == 0 || _since_key >= key_interval);
+    _since_key = key ? 1 : _since_key + 1;
+
+    // キーフレームは左隣 (行頭は上) を、それ以外は前フレームを予測値とする
+    static constexpr const size_t len = frame_width * frame_height;
+    auto predict = [&](size_t i) -> int32_t {
+        if (!key) return _prev_q[i];
+        if (i == 0) return 0;
+        size_t ref = (i % frame_width) ? i - 1 : i - frame_width;
+        return pixel_raw[ref] >> quantize_shift;
+    };
+    auto zigzag = [](int32_t d) -> uint32_t {
+        return (d < 0) ? ((-d << 1) - 1) : (d << 1);
+    };
+
+    uint32_t sum = 0;
+    for (size_t i = 0; i < len; ++i) {
+        sum += zigzag((pixel_raw[i] >> quantize_shift) - predict(i));
+    }
+    // 平均値の半分程度を剰余部のビット数とする
+    uint8_t k = 0;
+    while (k < recorder_escape_bits - 1 && (len << (k + 1)) <= sum) {
+        ++k;
+    }
+
+    auto& rec = _records[(_record_head + _record_count) % record_max];
+    rec.pos   = _write_pos;
+    rec.msec  = msec;
+    rec.k     = k;
+    rec.key   = key;
+
+    uint32_t bits     = 0;
+    uint_fast8_t used = 0;
+    auto put_bits     = [&](uint32_t value, uint_fast8_t count) {
+        bits |= value << used;
+        used += count;
+        while (used >= 8) {
+            _buffer[_write_pos++ & (buffer_size - 1)] = bits;
+            bits >>= 8;
+            used -= 8;
+        }
+    };
+    for (size_t i = 0; i < len; ++i) {
+        uint16_t q = pixel_raw[i] >> quantize_shift;
+        uint32_t z = zigzag(q - predict(i));
+        _prev_q[i] = q;
+        uint32_t u = z >> k;
+        if (u < recorder_escape_unary) {
+            put_bits((1u << u) - 1, u + 1);
+            put_bits(z & ((1u << k) - 1), k);
+        } else {
+            put_bits((1u << recorder_escape_unary) - 1, recorder_escape_unary);
+            put_bits(z, recorder_escape_bits);
+        }
+    }
+    if (used) {
+        _buffer[_write_pos++ & (buffer_size - 1)] = bits;
+    }
+    ++_record_count;
+
+    if (rising) {
+        _trigger_msec = msec;
+        _frozen       = true;
+    }
+}
+
+bool frame_recorder_t::decode(size_t index, uint16_t* pixel_raw,
+                              uint32_t* msec) const {
+    if (!_frozen || index >= _record_count) {
+        return false;
+    }
+    static constexpr const size_t len = frame_width * frame_height;
+    // 直前のキーフレームから順に復号する。途中は pixel_raw に丸めた値を置く
+    size_t start = index;
+    while (start && !_records[(_record_head + start) % record_max].key) {
+        --start;
+    }
+    for (size_t r = start; r <= index; ++r) {
+        auto& rec        = _records[(_record_head + r) % record_max];
+        uint32_t pos     = rec.pos;
+        uint32_t bits    = 0;
+        uint_fast8_t num = 0;
+        auto get_bit     = [&](void) -> uint32_t {
+            if (num == 0) {
+                bits = _buffer[pos++ & (buffer_size - 1)];
+                num  = 8;
+            }
+            uint32_t b = bits & 1;
+            bits >>= 1;
+            --num;
+            return b;
+        };
+        auto get_bits = [&](uint_fast8_t count) -> uint32_t {
+            uint32_t v = 0;
+            for (uint_fast8_t i = 0; i < count; ++i) {
+                v |= get_bit() << i;
+            }
+            return v;
+        };
+        for (size_t i = 0; i < len; ++i) {
+            uint32_t u = 0;
+            while (u < recorder_escape_unary && get_bit()) {
+                ++u;
+            }
+            uint32_t z = (u < recorder_escape_unary)
+                             ? (u << rec.k) | get_bits(rec.k)
+                             : get_bits(recorder_escape_bits);
+            int32_t d    = (z & 1) ? -(int32_t)((z + 1) >> 1) : (z >> 1);
+            int32_t pred = pixel_raw[i];
+            if (rec.key) {
+                pred = (i == 0)               ? 0
+                       : (i % frame_width)    ? pixel_raw[i - 1]
+                                              : pixel_raw[i - frame_width];
+            }
+            pixel_raw[i] = pred + d;
+        }
+    }
+    // 丸めた単位の中央の値に戻す
+    for (size_t i = 0; i < len; ++i) {
+        pixel_raw[i] = (pixel_raw[i] << quantize_shift) |
+                       (1 << (quantize_shift - 1));
+    }
+    *msec = _records[(_record_head + index) % record_max].msec;
+    return true;
+}
+
 void draw_param_t::setup(LovyanGFX* gfx_, framedata_t* frame_array_,
                          int frameindex) {
     _frame_array = frame_array_;
     frame        = &frame_array_[frameindex];
+    prev_frame   = frame;
     _lowest_value.set(frame->temp[frame->lowest]);
     _highest_value.set(frame->temp[frame->highest]);
     update(frameindex);
 
-    for (int i = 0; i < 4; ++i) {
-        auto tmp = frame->temp[i];
-        for (int j = 0; j < graph_data.data_len; ++j) {
-            graph_data.temp_arrays[i][j] = tmp;
-        }
-        // while (tmp != graph_filter[i].exec(tmp));
-    }
+    graph_data.fill(frame->temp);
+    // for (int i = 0; i < 4; ++i) {
+    //     while (frame->temp[i] != graph_filter[i].exec(frame->temp[i]));
+    // }
     _prev_frameindex = -1;
 }
 
@@ -454,19 +849,43 @@ void draw_param_t::setColorTable(size_t idx) {
 }
 
 bool draw_param_t::update(int frameindex) {
-    if (_prev_frameindex == frameindex) return false;
-    _prev_frameindex = frameindex;
-    frame            = &_frame_array[frameindex];
-    ++update_count;
-    return true;
+    uint32_t msec = millis();
+    bool result   = _prev_frameindex != frameindex;
+    if (result) {
+        _prev_frameindex = frameindex;
+        prev_frame       = frame;
+        frame            = &_frame_array[frameindex];
+        uint32_t period  = msec - _frame_msec;
+        _frame_msec      = msec;
+        if (period > 4000) {
+            period = 4000;
+        }
+        _frame_period = (_frame_period * 3 + period + 3) >> 2;
+        ++update_count;
+    }
+
+    // 4Hz以下ではサブページ到着ごとに画像が跳ぶため、到着からの経過時間に
+    // 応じて直前のフレームから徐々に移行させる。
+    // 設定値ではなく実際の到着間隔で判定する (4Hz:250ms と 8Hz:125ms の間)
+    static constexpr const uint32_t blend_min_period = 200;
+    uint32_t blend                                   = 256;
+    if (_frame_period >= blend_min_period && !in_pause_state) {
+        blend = ((msec - _frame_msec) << 8) / _frame_period;
+        if (blend > 256) {
+            blend = 256;
+        }
+    }
+    frame_blend = blend;
+    return result;
 }
 
 bool draw_param_t::range_update(void) {
     if (!frame) return false;
     if (range_autoswitch.get() == range_autoswitch_off) return true;
 
-    int32_t lowest  = frame->temp[frame->lowest];
-    int32_t highest = frame->temp[frame->highest];
+    // 外れ値の影響を受けないよう 1% / 99% 点を表示範囲とする
+    int32_t lowest  = frame->histogram.percentile(10);
+    int32_t highest = frame->histogram.percentile(990);
     int32_t margin  = ((highest - lowest) >> 4) + 1;
     lowest          = _lowest_value.exec(lowest - margin, margin);
     highest         = _highest_value.exec(highest + margin, margin);
@@ -480,6 +899,34 @@ bool draw_param_t::range_update(void) {
     return false;
 }
 
+bool draw_param_t::updateColorLut(void) {
+    auto src = color_map;
+    if (_color_lut_src == src && _color_lut_modify == modify_count) {
+        return false;
+    }
+    _color_lut_src    = src;
+    _color_lut_modify = modify_count;
+
+    color_lut_scale.setup(range_temp_lower, temp_diff, color_lut_len);
+    // 2x2 の組織的ディザの閾値 (位置 (y & 1) << 1 | (x & 1) ごと)
+    static constexpr const uint8_t bayer[4] = {0, 2, 3, 1};
+    for (size_t i = 0; i < color_lut_len; ++i) {
+        uint16_t c   = src[color_lut_scale.getPaletteIndex(i)];
+        color_lut[i] = m5gfx::getSwap16(c);
+
+        int32_t r = c >> 11;
+        int32_t g = (c >> 5) & 0x3F;
+        int32_t b = c & 0x1F;
+        for (size_t d = 0; d < 4; ++d) {
+            int32_t t        = bayer[d];
+            color_lut8[d][i] = ((r * 28 + t * 31 + 15) / 124) << 5 |
+                               ((g * 28 + t * 63 + 31) / 252) << 2 |
+                               ((b * 12 + t * 31 + 15) / 124);
+        }
+    }
+    return true;
+}
+
 int32_t value_smooth_t::exec(int32_t src, int32_t margin) {
     /*
             int32_t new_target = src << 8;
@@ -543,6 +990,14 @@ screenshot_streamer_t::screenshot_streamer_t(void) {
 
     // スクリーンショット更新の順番待ちができるクライアント（ブラウザ）の数
     _queue_client = xQueueCreate(4, sizeof(WiFiClient*));
+
+    // 8bit 描画バッファ (RGB332) からバイトスワップ済み RGB565 への展開表
+    for (int i = 0; i < 256; ++i) {
+        uint32_t r     = ((i >> 5) * 31 + 3) / 7;
+        uint32_t g     = (((i >> 2) & 7) * 63 + 3) / 7;
+        uint32_t b     = ((i & 3) * 31 + 1) / 3;
+        _palette332[i] = m5gfx::getSwap16(r << 11 | g << 5 | b);
+    }
 }
 
 void screenshot_streamer_t::requestScreenShot(WiFiClient* client) {
@@ -710,23 +1165,46 @@ screenshot_streamer_t::process_result_t screenshot_streamer_t::processCapture(
     _y += queue_ss.canvas->height();
     bool success = true;
     // bool lineend = false;
+    auto width       = queue_ss.canvas->width();
     auto framebuffer = (uint16_t*)(queue_ss.canvas->getBuffer());
+    bool depth8      = queue_ss.canvas->getColorDepth() == 8;
+    if (depth8 && _line565.size() < width) {
+        _line565.resize(width);
+    }
+    // 帯の行数がMCUの行数 (16) を超える場合は途中でもエンコードする
+    int mcu_lines = _jpeg_enc.get_mcu_lines();
+    int lines     = 0;
     for (int i = 0; i < queue_ss.canvas->height(); ++i) {
-        success = _jpeg_enc.process_scanline565(
-            &framebuffer[i * queue_ss.canvas->width()]);
-        if (++queue_ss.y >= _height) {
-            break;
+        auto line = &framebuffer[i * width];
+        if (depth8) {
+            // 8bit 描画バッファは1行ずつ RGB565 に展開してからエンコードする
+            auto src = &((const uint8_t*)framebuffer)[i * width];
+            for (int x = 0; x < width; ++x) {
+                _line565[x] = _palette332[src[x]];
+            }
+            line = _line565.data();
         }
+        success = _jpeg_enc.process_scanline565(line);
         if (!success) {
             break;
         }
+        ++lines;
+        if (++queue_ss.y >= _height) {
+            break;
+        }
+        if (lines == mcu_lines) {
+            _jpeg_enc.process_mcu_row();
+            lines = 0;
+        }
     }
     // 画像データの読出しを終えた後でキューから取り出す
     xQueueReceive(_queue_canvas, &queue_ss, 0);
 
     // JPEGのエンコード処理部分を実行する
     if (success) {
-        _jpeg_enc.process_mcu_row();
+        if (lines) {
+            _jpeg_enc.process_mcu_row();
+        }
         if (_y >= _height) {
             _y = 0;
             _jpeg_enc.process_scanline565(nullptr);
@@ -745,6 +1223,51 @@ struct ui_base_t {
                _prev_modify_count != param->modify_count;
     }
 
+    // isModified の結果を返し、次の呼び出しまで変化なしとする
+    bool checkModified(draw_param_t* param) {
+        bool res           = isModified(param);
+        _prev_update_count = param->update_count;
+        _prev_modify_count = param->modify_count;
+        return res;
+    }
+
+    // 変化した領域を自分で invalidate() する UI は true を返す。
+    // false の UI は表示されている間、毎回全体を描き直す
+    virtual bool isDamageTracked(void) const {
+        return false;
+    }
+    // 別のコアで同時に (異なる帯を) draw() しても安全な UI は true を返す
+    virtual bool isParallelDrawable(void) const {
+        return false;
+    }
+    void invalidate(void) {
+        invalidate(_client_rect);
+    }
+    void invalidate(const rect_t& rect) {
+        if (rect.empty()) {
+            return;
+        }
+        if (_invalid_rect.empty()) {
+            _invalid_rect = rect;
+            return;
+        }
+        int l = _invalid_rect.left();
+        int t = _invalid_rect.top();
+        int r = _invalid_rect.right();
+        int b = _invalid_rect.bottom();
+        if (l > rect.left()) l = rect.left();
+        if (t > rect.top()) t = rect.top();
+        if (r < rect.right()) r = rect.right();
+        if (b < rect.bottom()) b = rect.bottom();
+        _invalid_rect = {l, t, r - l, b - t};
+    }
+    inline void clearInvalidate(void) {
+        _invalid_rect = rect_t();
+    }
+    const rect_t& getInvalidRect(void) const {
+        return _invalid_rect;
+    }
+
     virtual void update(draw_param_t* param) {
     }
 
@@ -763,7 +1286,13 @@ struct ui_base_t {
     }
 
     virtual bool smoothMove(void) {
-        return _client_rect.smooth_move(_target_rect);
+        rect_t prev = _client_rect;
+        if (!_client_rect.smooth_move(_target_rect)) {
+            return false;
+        }
+        invalidate(prev);
+        invalidate();
+        return true;
     }
     virtual void setTargetRect(const rect_t& rect) {
         _target_rect = rect;
@@ -794,12 +1323,9 @@ struct ui_base_t {
     }
 
    protected:
-    // inline void clearInvalidate(void) {
-    //     _invalidate = false;
-    // }
-    // bool _invalidate;
     rect_t _client_rect;
     rect_t _target_rect;
+    rect_t _invalid_rect;
     uint8_t _prev_update_count;
     uint8_t _prev_modify_count;
 };
@@ -928,14 +1454,26 @@ class overlay_ui_t : public ui_base_t {
             if (dy < 0) dy = 0;
             if (dye > h) dye = h;
 
-            uint32_t cw2 = (client_width + 1) >> 1;
-            for (; dy < dye; ++dy) {
-                auto b = (uint32_t*)(&buf[canvas_w * dy]);
-                for (int x = 0; x < cw2; ++x) {
-                    uint32_t tmp = b[x];
-                    b[x] = (tmp >> 1) & 0x6F7B6F7B | ((tmp & 0x00010001) << 15);
-                    // tmp = (tmp << 7 | tmp >> 9) & 0x7BEF;
-                    // b[x] = tmp << 8 | tmp >> 8;
+            if (canvas->getColorDepth() == 8) {
+                // RGB332 の各成分を半分にする
+                auto buf8 = ((uint8_t*)canvas->getBuffer()) + client_x;
+                for (; dy < dye; ++dy) {
+                    auto b = &buf8[canvas_w * dy];
+                    for (int x = 0; x < client_width; ++x) {
+                        b[x] = (b[x] >> 1) & 0x6D;
+                    }
+                }
+            } else {
+                uint32_t cw2 = (client_width + 1) >> 1;
+                for (; dy < dye; ++dy) {
+                    auto b = (uint32_t*)(&buf[canvas_w * dy]);
+                    for (int x = 0; x < cw2; ++x) {
+                        uint32_t tmp = b[x];
+                        b[x]         = (tmp >> 1) & 0x6F7B6F7B |
+                               ((tmp & 0x00010001) << 15);
+                        // tmp = (tmp << 7 | tmp >> 9) & 0x7BEF;
+                        // b[x] = tmp << 8 | tmp >> 8;
+                    }
                 }
             }
         }
@@ -1611,6 +2149,8 @@ class config_ui_t : public container_ui_t {
             "Temperature", "设定温度", "設定温度"};
         static constexpr const localize_text_t lt_Emissivity = {
             "Emissivity", "辐射率", "放射率"};
+        static constexpr const localize_text_t lt_Reflected = {
+            "Reflected Temp", "反射温度", "反射温度"};
         static constexpr const single_text_t lt_Language = {"Language"};
         static constexpr const localize_text_t lt_LAN_Stream_Quality = {
             "LAN Stream Quality", "局域网视频流画质", "LANモニタの画質"};
@@ -1648,6 +2188,7 @@ class config_ui_t : public container_ui_t {
             new token_ui_t{&lt_Cloud_Confirm_Code, &draw_param.cloud_token});
         cloud_config_ui.addItem(
             new value_ui_t{&draw_param.cloud_interval, true});
+        cloud_config_ui.addItem(new value_ui_t{&draw_param.cloud_dutycycle});
         alarm_config_ui.addItem(new value_ui_t{&draw_param.alarm_mode, true});
         alarm_config_ui.addItem(
             new value_ui_t{&lt_Temperature, &draw_param.alarm_temperature});
@@ -1661,6 +2202,10 @@ class config_ui_t : public container_ui_t {
             new value_ui_t{&draw_param.sens_monitorarea, true});
         sens_config_ui.addItem(
             new value_ui_t{&lt_Emissivity, &draw_param.sens_emissivity});
+        sens_config_ui.addItem(
+            new value_ui_t{&lt_Reflected, &draw_param.sens_reflected});
+        sens_config_ui.addItem(new value_ui_t{&draw_param.sens_scenegate});
+        sens_config_ui.addItem(new value_ui_t{&draw_param.sens_scenesens});
         range_config_ui.addItem(new value_ui_t{&draw_param.range_autoswitch});
         range_config_ui.addItem(
             new value_ui_t{&lt_Sens_TempHighest, &draw_param.range_temp_upper});
@@ -1668,9 +2213,15 @@ class config_ui_t : public container_ui_t {
             new value_ui_t{&lt_Sens_TempLowest, &draw_param.range_temp_lower});
         misc_config_ui.addItem(new value_ui_t{&draw_param.misc_language, true});
         misc_config_ui.addItem(new value_ui_t{&draw_param.misc_cpuspeed, true});
+        misc_config_ui.addItem(new value_ui_t{&draw_param.misc_governor});
         misc_config_ui.addItem(new value_ui_t{&draw_param.misc_volume, true});
         misc_config_ui.addItem(
             new value_ui_t{&draw_param.misc_brightness, true});
+        misc_config_ui.addItem(new value_ui_t{&draw_param.misc_graphspan});
+        misc_config_ui.addItem(new value_ui_t{&draw_param.misc_upscale});
+        misc_config_ui.addItem(new value_ui_t{&draw_param.misc_dualcore});
+        misc_config_ui.addItem(new value_ui_t{&draw_param.misc_drawbuf});
+        misc_config_ui.addItem(new value_ui_t{&draw_param.misc_headless});
         misc_config_ui.addItem(new value_ui_t{&lt_LAN_Stream_Quality,
                                               &draw_param.net_jpg_quality});
         misc_config_ui.addItem(new value_ui_t{
@@ -1825,6 +2376,10 @@ void config_param_t::sens_noisefilter_func(sens_noisefilter_t v) {
 void config_param_t::perf_emissivity_func(uint8_t v) {
     command_processor::setEmissivity(v);
 }
+void config_param_t::sens_reflected_func(int8_t v) {
+    command_processor::setReflectedTemperature(
+        v <= sens_reflected_auto ? command_processor::reflected_auto : v);
+}
 void config_param_t::range_temperature_func(int32_t) {
     if (draw_param.range_temp_upper.get() <=
         draw_param.range_temp_lower.get()) {
@@ -1836,19 +2391,34 @@ void config_param_t::range_temperature_func(int32_t) {
     }
     draw_param.temp_diff = abs(draw_param.range_temp_upper.get() -
                                draw_param.range_temp_lower.get());
+    ++draw_param.modify_count;
 }
 
 void config_param_t::misc_color_func(misc_color_t v) {
     draw_param.color_map = color_map_table[v];
+    ++draw_param.modify_count;
 }
 
 class battery_ui_t : public ui_base_t {
     int8_t prev_battery_level = 0;
+    int8_t prev_battery_state = 0;
 
    public:
+    bool isDamageTracked(void) const override {
+        return true;
+    }
+    bool isParallelDrawable(void) const override {
+        return true;
+    }
+
     void update(draw_param_t* param) override {
-        prev_battery_level =
-            smooth_move(param->battery_level, prev_battery_level);
+        int8_t level = smooth_move(param->battery_level, prev_battery_level);
+        if (prev_battery_level != level ||
+            prev_battery_state != param->battery_state) {
+            prev_battery_level = level;
+            prev_battery_state = param->battery_state;
+            invalidate();
+        }
     }
 
     void draw(draw_param_t* param, M5Canvas* canvas, int32_t canvas_y,
@@ -1867,14 +2437,73 @@ class header_ui_t : public ui_base_t {
     std::string _text;
     int32_t _text_width;
     int32_t _text_pos = 0;
+    // 表示中のアイコン (変化した時だけ描き直す)
+    uint8_t _wifi_level       = 0;
+    int8_t _cloud_idx         = -1;
+    uint16_t _cloud_countdown = 0;
+
+    void updateIcon(draw_param_t* param) {
+        uint8_t level = 0;
+        if (param->net_running_mode & param->net_running_mode_lan) {
+            level = 1;
+        }
+        if (WiFi.status() == WL_CONNECTED) {
+            auto rssi = WiFi.RSSI();
+            level     = (rssi <= -96)   ? 2
+                        : (rssi <= -85) ? 3
+                        : (rssi <= -75) ? 4
+                                        : 5;
+        }
+
+        int8_t idx = -1;
+        if (param->net_running_mode & param->net_running_mode_cloud) {
+            switch (param->cloud_status) {
+                case param->cloud_status_t::cloud_connection:
+                    idx = 0;
+                    break;
+                case param->cloud_status_t::cloud_uploading:
+                    idx = (param->draw_count >> 3) & 3;
+                    break;
+                case param->cloud_status_t::cloud_complete:
+                    idx = 4;
+                    break;
+                case param->cloud_status_t::cloud_error:
+                    idx = 5;
+                    break;
+                case param->cloud_status_t::cloud_timerwait:
+                    idx = 6;
+                    break;
+                default:
+                    break;
+            }
+        }
+        uint16_t countdown = (idx == 6) ? param->cloud_countdown_sec : 0;
+
+        if (_wifi_level != level || _cloud_idx != idx ||
+            _cloud_countdown != countdown) {
+            _wifi_level      = level;
+            _cloud_idx       = idx;
+            _cloud_countdown = countdown;
+            invalidate();
+        }
+    }
 
    public:
+    bool isDamageTracked(void) const override {
+        return true;
+    }
+    bool isParallelDrawable(void) const override {
+        return true;
+    }
+
     void update(draw_param_t* param) override {
+        updateIcon(param);
         if (!param->in_config_mode) {
             if (_text_width) {
                 _text_width = 0;
                 _text_pos   = 0;
                 _text.clear();
+                invalidate();
             }
         } else {
             if ((param->draw_count & 3) == 0) {
@@ -1935,6 +2564,7 @@ class header_ui_t : public ui_base_t {
             if (_text_width + _text_pos < 0) {
                 _text_pos += _text_width;
             }
+            invalidate();
         }
     }
 
@@ -1969,45 +2599,15 @@ class header_ui_t : public ui_base_t {
 
         int xpos = _client_rect.right();
         {
-            size_t level = 0;
-            if (param->net_running_mode & param->net_running_mode_lan) {
-                level = 1;
-            }
-            if (WiFi.status() == WL_CONNECTED) {
-                auto rssi = WiFi.RSSI();
-                level     = (rssi <= -96)   ? 2
-                            : (rssi <= -85) ? 3
-                            : (rssi <= -75) ? 4
-                                            : 5;
-            }
             xpos -= 14;
             // canvas->drawBitmap(xpos+1, _client_rect.y - canvas_y,
             // icon_wifi[level], 16, 12, TFT_WHITE);
             canvas->pushImage(xpos, _client_rect.y - canvas_y, 16, 14,
-                              icon_wifi565[level], 0x2002);
+                              icon_wifi565[_wifi_level], 0x2002);
         }
 
-        if (param->net_running_mode & param->net_running_mode_cloud) {
-            int idx = -1;
-            switch (param->cloud_status) {
-                case param->cloud_status_t::cloud_connection:
-                    idx = 0;
-                    break;
-                case param->cloud_status_t::cloud_uploading:
-                    idx = (param->draw_count >> 3) & 3;
-                    break;
-                case param->cloud_status_t::cloud_complete:
-                    idx = 4;
-                    break;
-                case param->cloud_status_t::cloud_error:
-                    idx = 5;
-                    break;
-                case param->cloud_status_t::cloud_timerwait:
-                    idx = 6;
-                    break;
-                default:
-                    break;
-            }
+        {
+            int idx = _cloud_idx;
             if (idx >= 0) {
                 xpos -= 16;
                 // canvas->drawBitmap(xpos+1, _client_rect.y - canvas_y,
@@ -2019,7 +2619,7 @@ class header_ui_t : public ui_base_t {
                     canvas->setTextSize(1);
                     canvas->setTextColor(TFT_WHITE);
                     canvas->setTextDatum(textdatum_t::top_right);
-                    xpos -= canvas->drawNumber(param->cloud_countdown_sec, xpos,
+                    xpos -= canvas->drawNumber(_cloud_countdown, xpos,
                                                _client_rect.y - canvas_y - 1,
                                                &fonts::Font2);
                 }
@@ -2055,9 +2655,120 @@ class header_ui_t : public ui_base_t {
     }
 };
 
+// 温度表示に使う数字と記号を、フォント・拡大率ごとに描画済みで保持する。
+// 描画時は 1bit の画像を drawBitmap で並べるだけにする。
+// build は条件が変わった時だけ作り直すため毎回呼び出してよい
+static constexpr const char glyph_chars[] = "0123456789.- /";
+
+struct glyph_atlas_t {
+    static constexpr const size_t glyph_count = sizeof(glyph_chars) - 1;
+    struct glyph_t {
+        int16_t width = 0;
+        std::vector<uint8_t> fill;  // 文字の画素
+        std::vector<uint8_t> edge;  // 縁取り (outline 指定時のみ)
+    };
+    glyph_t glyph[glyph_count];
+    const m5gfx::IFont* font = nullptr;
+    float scale_x            = 0.0f;
+    float scale_y            = 0.0f;
+    int16_t height           = 0;
+    uint8_t pad              = 0;  // 縁取りの幅
+
+    static int getIndex(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c == '.') return 10;
+        if (c == '-') return 11;
+        if (c == ' ') return 12;
+        if (c == '/') return 13;
+        return -1;
+    }
+
+    bool build(const m5gfx::IFont* font_, float sx, float sy, bool outline) {
+        uint8_t pad_ = outline ? 1 : 0;
+        if (font == font_ && scale_x == sx && scale_y == sy && pad == pad_) {
+            return false;
+        }
+        font    = font_;
+        scale_x = sx;
+        scale_y = sy;
+        pad     = pad_;
+
+        M5Canvas tmp;
+        tmp.setColorDepth(1);
+        tmp.setFont(font_);
+        tmp.setTextSize(sx, sy);
+        tmp.setTextDatum(textdatum_t::top_left);
+        height = tmp.fontHeight();
+        for (size_t i = 0; i < glyph_count; ++i) {
+            auto& g    = glyph[i];
+            char s[2]  = {glyph_chars[i], 0};
+            g.width    = tmp.textWidth(s);
+            int32_t bw = g.width + pad * 2;
+            int32_t bh = height + pad * 2;
+            g.fill.clear();
+            g.edge.clear();
+            if (g.width <= 0 || !tmp.createSprite(bw, bh)) {
+                continue;
+            }
+            // 1bit の画像は1行が (幅+7)/8 バイトで drawBitmap と同じ並び
+            size_t len = ((bw + 7) >> 3) * bh;
+            auto buf   = (const uint8_t*)tmp.getBuffer();
+            tmp.setTextColor(1);
+            if (outline) {
+                tmp.fillScreen(0);
+                for (int32_t xy = 0; xy < 9; ++xy) {
+                    tmp.drawString(s, xy % 3, xy / 3);
+                }
+                g.edge.assign(buf, buf + len);
+            }
+            tmp.fillScreen(0);
+            tmp.drawString(s, pad, pad);
+            g.fill.assign(buf, buf + len);
+            tmp.deleteSprite();
+        }
+        return true;
+    }
+
+    int32_t textWidth(const char* text) const {
+        int32_t w = 0;
+        for (; *text; ++text) {
+            int i = getIndex(*text);
+            if (i >= 0) {
+                w += glyph[i].width;
+            }
+        }
+        return w + pad * 2;
+    }
+
+    // x, y は左上 (縁取りを含む) の座標。edge_color は outline 時のみ使う
+    template <typename T>
+    void draw(LovyanGFX* gfx, const char* text, int32_t x, int32_t y,
+              const T& color, const T& edge_color = T()) const {
+        int32_t bh = height + pad * 2;
+        for (; *text; ++text) {
+            int i = getIndex(*text);
+            if (i < 0) {
+                continue;
+            }
+            auto& g    = glyph[i];
+            int32_t bw = g.width + pad * 2;
+            if (!g.edge.empty()) {
+                gfx->drawBitmap(x, y, g.edge.data(), bw, bh, edge_color);
+            }
+            if (!g.fill.empty()) {
+                gfx->drawBitmap(x, y, g.fill.data(), bw, bh, color);
+            }
+            x += g.width;
+        }
+    }
+};
+
 class image_ui_t : public ui_base_t {
     struct marker_t {
-        M5Canvas txtimg;
+        glyph_atlas_t atlas;
+        char text[8]             = "";
+        int16_t text_w           = 0;
+        int16_t text_h           = 0;
         const m5gfx::IFont* font = nullptr;
 
         int16_t mark_x = 64;
@@ -2082,7 +2793,7 @@ class image_ui_t : public ui_base_t {
 
             if (font != font_) {
                 font = font_;
-                txtimg.setFont(font_);
+                atlas.build(font_, 1.0f, 1.0f, true);
                 raw = 0;
             }
             /*
@@ -2096,7 +2807,6 @@ class image_ui_t : public ui_base_t {
             if (raw != raw_) {
                 raw    = raw_;
                 result = true;
-                char text[8];
                 snprintf(text, sizeof(text), "%5.1f ",
                          convertRawToCelsius(raw_));
 
@@ -2108,21 +2818,9 @@ class image_ui_t : public ui_base_t {
                    config_param_t::alarm_reference_text[draw_param.alarm_reference];
                                 }
                 */
-                txtimg.setColorDepth(2);
-                txtimg.createSprite(txtimg.textWidth(text_ptr) + 2,
-                                    txtimg.fontHeight() + 2);
-                txtimg.setPivot(txtimg.width() / 2.0f, txtimg.height() / 2.0f);
-                txtimg.setPaletteColor(1, TFT_BLACK);
-                txtimg.setPaletteColor(3, TFT_WHITE);
-                txtimg.setTextColor(1);
-                static constexpr const uint8_t xytbl[] = {
-                    0x00, 0x01, 0x02, 0x12, 0x22, 0x21, 0x20, 0x10, 0x11};
-                for (uint_fast8_t xy : xytbl) {
-                    if (xy == 0x11u) {
-                        txtimg.setTextColor(3);
-                    }
-                    txtimg.drawString(text_ptr, xy >> 4, xy & 3);
-                }
+                // 縁取り付きの文字は描画時に atlas から並べる
+                text_w = atlas.textWidth(text_ptr);
+                text_h = atlas.height + 2;
             }
 
             int tx;
@@ -2139,7 +2837,7 @@ class image_ui_t : public ui_base_t {
                 //     tx += txtimg.height() * (x_ < (frame_width >> 1) ? 2 :
                 //     -2);
                 // } else
-                { ty += txtimg.height() * (y_ < (frame_height >> 1) ? 2 : -2); }
+                { ty += text_h * (y_ < (frame_height >> 1) ? 2 : -2); }
             }
             tx = smooth_tx.exec(tx, 0);
             ty = smooth_ty.exec(ty, 0);
@@ -2149,8 +2847,7 @@ class image_ui_t : public ui_base_t {
             //     (txtimg.width() >> 1);
             // } else
             {
-                tx = ((tx * (rect.w - txtimg.width()) + 128) >> 8) +
-                     (txtimg.width() >> 1);
+                tx = ((tx * (rect.w - text_w) + 128) >> 8) + (text_w >> 1);
                 ty = ((ty * rect.h + 128) >> 8) + 2;
             }
             result |= text_x != tx || text_y != ty;
@@ -2162,48 +2859,193 @@ class image_ui_t : public ui_base_t {
     };
     marker_t _marker;
 
+    // ユーザー定義領域の最高/平均温度の表示 (枠の左上に重ねる)
+    struct roi_label_t {
+        char text[16]    = "";
+        uint16_t highest = 0;
+        uint16_t average = 0;
+    };
+    roi_label_t _roi_label[roi_engine_t::roi_max];
+
+    interp_axis_t _cols;
+    interp_axis_t _rows;
+    rect_t _table_rect;
+
+    // センサ画素ごとの変換テーブル上の位置と、横方向に補間した2行分の
+    // キャッシュ (2コアで同時に描画できるようコアごとに持つ)
+    uint16_t _level[frame_width * frame_height];
+    std::vector<uint32_t> _hrow[portNUM_PROCESSORS][2];
+    int32_t _hrow_src[portNUM_PROCESSORS][2];
+
+    // Bicubic 拡大済みの画像 (変換テーブル上の位置)。センサのフレーム到着時か
+    // 表示範囲の変更時にだけ作り直し、描画時は変換テーブルを引くだけにする
+    std::vector<int16_t> _cubic_hrow;
+    std::vector<uint16_t> _cubic_img;
+    uint8_t _cubic_update_count = 0;
+    uint8_t _cubic_modify_count = 0;
+    bool _cubic_dirty           = true;
+    bool _use_cubic             = false;
+
+    void updateCubic(draw_param_t* param) {
+        // 時間補間中や拡大縮小中は毎回作り直しになるため従来の補間で描く
+        _use_cubic = param->misc_upscale == param->misc_upscale_bicubic &&
+                     param->frame_blend >= 256 &&
+                     _client_rect == _target_rect;
+        if (!_use_cubic) {
+            if (param->misc_upscale != param->misc_upscale_bicubic &&
+                !_cubic_img.empty()) {
+                std::vector<int16_t>().swap(_cubic_hrow);
+                std::vector<uint16_t>().swap(_cubic_img);
+            }
+            _cubic_dirty = true;
+            return;
+        }
+        if (!_cubic_dirty && _cubic_update_count == param->update_count &&
+            _cubic_modify_count == param->modify_count) {
+            return;
+        }
+        _cubic_dirty        = false;
+        _cubic_update_count = param->update_count;
+        _cubic_modify_count = param->modify_count;
+
+        int32_t w = _client_rect.w;
+        int32_t h = _client_rect.h;
+        _cubic_hrow.resize(frame_height * w);
+        _cubic_img.resize(w * h);
+
+        // 横方向: センサの各行を描画幅に拡大する
+        for (int32_t fy = 0; fy < frame_height; ++fy) {
+            interpolateCubicRow<frame_width>(&_level[fy * frame_width], _cols,
+                                             w, &_cubic_hrow[fy * w]);
+        }
+        // 縦方向: 4行分を合成して変換テーブル上の位置にする
+        interpolateCubicImage(_cubic_hrow.data(), frame_height, _rows, w, h,
+                              param->color_lut_scale.max, _cubic_img.data());
+    }
+
+    void updateLevel(draw_param_t* param) {
+        if (_table_rect.w != _client_rect.w ||
+            _table_rect.h != _client_rect.h) {
+            _table_rect = _client_rect;
+            _cols.build(_client_rect.w, frame_width - 1);
+            _rows.build(_client_rect.h, frame_height - 1);
+            for (auto& hrow : _hrow) {
+                hrow[0].resize(_client_rect.w);
+                hrow[1].resize(_client_rect.w);
+            }
+            _cubic_dirty = true;
+        }
+        memset(_hrow_src, 0xFF, sizeof(_hrow_src));
+
+        // 直前のフレームとの時間補間 (frame_blend == 256 なら補間なし)
+        const uint16_t* cur_raw  = param->frame->pixel_raw;
+        const uint16_t* prev_raw = param->prev_frame->pixel_raw;
+        int32_t blend            = param->frame_blend;
+        for (size_t i = 0; i < frame_width * frame_height; ++i) {
+            int32_t raw = cur_raw[i];
+            if (blend < 256) {
+                int32_t prev = prev_raw[i];
+                raw          = prev + (((raw - prev) * blend) >> 8);
+            }
+            _level[i] = param->getColorIndex(raw);
+        }
+    }
+
    public:
     void pointerChange(void) {
         draw_param.misc_pointer.add(1);
     }
 
+    bool isDamageTracked(void) const override {
+        return true;
+    }
+    bool isParallelDrawable(void) const override {
+        return true;
+    }
+
     void update(draw_param_t* param) override {
+        if (!_client_rect.empty()) {
+            updateLevel(param);
+            updateCubic(param);
+        }
+        // 新しいフレーム・表示範囲の変更・時間補間中は全体を描き直す
+        if (checkModified(param) || param->frame_blend < 256) {
+            invalidate();
+        }
         {
+            auto frame = param->frame;
             int mark_x;
             int mark_y;
+            uint32_t temp;
             switch (param->alarm_reference) {
                 case draw_param_t::alarm_reference_lowest:
-                    mark_x = param->frame->low_x;
-                    mark_y = param->frame->low_y;
+                    mark_x = frame->low_x;
+                    mark_y = frame->low_y;
+                    temp   = frame->temp[frame->lowest];
                     break;
 
+                case draw_param_t::alarm_reference_hotspot:
+                    // 最も高温な領域の重心に表示する
+                    if (frame->blobs.count) {
+                        auto blob = &frame->blobs.blobs[0];
+                        mark_x    = (blob->cx + 8) >> 4;
+                        mark_y    = (blob->cy + 8) >> 4;
+                        temp      = blob->peak;
+                        break;
+                    }
+                    // fall through
+
                 case draw_param_t::alarm_reference_highest:
-                    mark_x = param->frame->high_x;
-                    mark_y = param->frame->high_y;
+                    mark_x = frame->high_x;
+                    mark_y = frame->high_y;
+                    temp   = frame->temp[frame->highest];
                     break;
 
                 case draw_param_t::alarm_reference_average:
                     mark_x = -1;
                     mark_y = -1;
+                    temp   = frame->temp[frame->average];
+                    break;
+
+                case draw_param_t::alarm_reference_median:
+                    mark_x = -1;
+                    mark_y = -1;
+                    temp   = frame->histogram.median();
                     break;
 
                 default:
                     mark_x = frame_width >> 1;
                     mark_y = frame_height >> 1;
+                    temp   = frame->pixel_raw[mark_x + (frame_width * mark_y)];
                     break;
             }
-            uint32_t temp =
-                mark_x < 0
-                    ? param->frame->temp[param->frame->average]
-                    : param->frame->pixel_raw[mark_x + (frame_width * mark_y)];
             bool txtmod = (temp != _marker.raw);
             if (_marker.update(temp, _client_rect, mark_x, mark_y,
-                               param->font)) {
-                // invalidate();
+                               param->font) &&
+                param->misc_pointer != param->misc_pointer_off) {
+                invalidate();
+            }
+            for (size_t i = 0; i < roi_engine_t::roi_max; ++i) {
+                auto& label = _roi_label[i];
+                auto& roi   = frame->roi[i];
+                if (label.text[0] && label.highest == roi.highest &&
+                    label.average == roi.average) {
+                    continue;
+                }
+                label.highest = roi.highest;
+                label.average = roi.average;
+                snprintf(label.text, sizeof(label.text), "%.1f/%.1f",
+                         convertRawToCelsius(roi.highest),
+                         convertRawToCelsius(roi.average));
+                invalidate();
             }
         }
 
-        // clearInvalidate();
+        // ポインタは点滅するため、その周囲だけを毎回描き直す
+        if (param->misc_pointer != param->misc_pointer_off) {
+            invalidate({_client_rect.x + _marker.mark_x - 6,
+                        _client_rect.y + _marker.mark_y - 6, 13, 13});
+        }
     }
 
     void draw(draw_param_t* param, M5Canvas* canvas, int32_t canvas_y,
@@ -2216,74 +3058,89 @@ class image_ui_t : public ui_base_t {
         //     &h); if (0 == (w + h)) { return; }
         // }
 
-        int32_t y1 = _client_rect.y;
-        for (int32_t fy = 1; fy < frame_height; ++fy) {
-            int32_t y0 = y1;
-            y1 = _client_rect.y + (fy * _client_rect.h) / (frame_height - 1);
-
-            if (y1 - canvas_y < 0) {
-                continue;
-            }
-            if (y0 - canvas_y >= _client_rect.bottom()) {
-                break;
+        // 横方向の補間結果をセンサの行単位でキャッシュし、縦方向の補間と
+        // 変換テーブルの参照だけを画素ごとに行う
+        auto hrow_buf = _hrow[xPortGetCoreID()];
+        auto hrow_src = _hrow_src[xPortGetCoreID()];
+        auto hrow     = [&](int32_t fy) -> const uint32_t* {
+            auto& buf = hrow_buf[fy & 1];
+            if (hrow_src[fy & 1] != fy) {
+                hrow_src[fy & 1] = fy;
+                interpolateLinearRow(&_level[fy * frame_width], _cols,
+                                     _client_rect.w, buf.data());
             }
+            return buf.data();
+        };
 
-            int32_t boxHeight = y1 - y0;
-            if (boxHeight == 0) continue;
-
-            int32_t v0;
-            int32_t v1 = ((param->frame->pixel_raw[(fy - 1) * frame_width] -
-                           param->range_temp_lower)
-                          << 8) /
-                         param->temp_diff;
-            v1 = (v1 < 0) ? 0 : (v1 > 255) ? 255 : v1;
-            int32_t v2;
-            int32_t v3 = ((param->frame->pixel_raw[(fy)*frame_width] -
-                           param->range_temp_lower)
-                          << 8) /
-                         param->temp_diff;
-            v3 = (v3 < 0) ? 0 : (v3 > 255) ? 255 : v3;
-            int32_t x1 = 0;
-            for (int32_t fx = 1; fx < frame_width; ++fx) {
-                int32_t x0       = x1;
-                x1               = (fx * _client_rect.w) / (frame_width - 1);
-                int32_t boxWidth = x1 - x0;
-                v0               = v1;
-                v1 = ((param->frame->pixel_raw[fx + (fy - 1) * frame_width] -
-                       param->range_temp_lower)
-                      << 8) /
-                     param->temp_diff;
-                v1 = (v1 < 0) ? 0 : (v1 > 255) ? 255 : v1;
-                v2 = v3;
-                v3 = ((param->frame->pixel_raw[fx + (fy)*frame_width] -
-                       param->range_temp_lower)
-                      << 8) /
-                     param->temp_diff;
-                v3 = (v3 < 0) ? 0 : (v3 > 255) ? 255 : v3;
-                if (boxWidth == 0) continue;
-                uint32_t mul = (1 << 16) / (boxWidth * boxHeight);
-
-                int32_t ypos = y0 - canvas_y;
-                int32_t by   = 0;
-                if (ypos < 0) {
-                    by   = -ypos;
-                    ypos = 0;
-                }
-                for (; by < boxHeight && ypos < canvas->height();
-                     ++by, ++ypos) {
-                    uint32_t v02 = (v0 * (boxHeight - by) + v2 * by) * mul;
-                    uint32_t v13 = (v1 * (boxHeight - by) + v3 * by) * mul;
-                    auto img_buf =
-                        &((m5gfx::swap565_t*)
-                              canvas->getBuffer())[_client_rect.x + x0 +
-                                                   ypos * canvas->width()];
-                    for (int32_t bx = 0; bx < boxWidth; ++bx) {
-                        uint32_t v   = (v02 * (boxWidth - bx) + v13 * bx) >> 16;
-                        img_buf[bx] = m5gfx::getSwap16(param->color_map[v]);
+        int32_t ystart = _client_rect.y - canvas_y;
+        int32_t yend   = _client_rect.bottom() - canvas_y;
+        if (ystart < 0) ystart = 0;
+        if (yend > h) yend = h;
+        int32_t xstart = (_client_rect.x < 0) ? -_client_rect.x : 0;
+        int32_t xend   = canvas->width() - _client_rect.x;
+        if (xend > _client_rect.w) xend = _client_rect.w;
+        auto color_lut = param->color_lut;
+        bool depth8    = canvas->getColorDepth() == 8;
+        for (int32_t ypos = ystart; ypos < yend; ++ypos) {
+            int32_t y   = ypos + canvas_y - _client_rect.y;
+            int32_t pos = _client_rect.x + ypos * canvas->width();
+            if (depth8) {
+                // 8bit 描画バッファは画面上の位置に応じたディザで RGB332 にする
+                auto img_buf = &((uint8_t*)canvas->getBuffer())[pos];
+                auto lut     = &param->color_lut8[((ypos + canvas_y) & 1) << 1];
+                int32_t xodd = _client_rect.x & 1;
+                if (_use_cubic) {
+                    auto src = &_cubic_img[y * _client_rect.w];
+                    for (int32_t x = xstart; x < xend; ++x) {
+                        img_buf[x] = lut[(x + xodd) & 1][src[x]];
                     }
+                    continue;
+                }
+                int32_t fy  = _rows.src[y];
+                int32_t wy  = _rows.weight[y];
+                auto top    = hrow(fy);
+                auto bottom = hrow(fy + 1);
+                for (int32_t x = xstart; x < xend; ++x) {
+                    uint32_t v = interpolateLinear(top[x], bottom[x], wy);
+                    img_buf[x] = lut[(x + xodd) & 1][v];
+                }
+                continue;
+            }
+            auto img_buf = &((uint16_t*)canvas->getBuffer())[pos];
+            if (_use_cubic) {
+                auto src = &_cubic_img[y * _client_rect.w];
+                for (int32_t x = xstart; x < xend; ++x) {
+                    img_buf[x] = color_lut[src[x]];
                 }
+                continue;
+            }
+            int32_t fy  = _rows.src[y];
+            int32_t wy  = _rows.weight[y];
+            auto top    = hrow(fy);
+            auto bottom = hrow(fy + 1);
+            for (int32_t x = xstart; x < xend; ++x) {
+                uint32_t v = interpolateLinear(top[x], bottom[x], wy);
+                img_buf[x] = color_lut[v];
+            }
+        }
+        // ユーザー定義領域の枠を描画する
+        for (auto& roi : param->roi_rect) {
+            if (roi.w == 0 || roi.h == 0) {
+                continue;
             }
+            int x0 = roi.x * _client_rect.w / (frame_width - 1);
+            int y0 = roi.y * _client_rect.h / (frame_height - 1);
+            int x1 = (roi.x + roi.w - 1) * _client_rect.w / (frame_width - 1);
+            int y1 = (roi.y + roi.h - 1) * _client_rect.h / (frame_height - 1);
+            canvas->drawRect(_client_rect.x + x0,
+                             _client_rect.y + y0 - canvas_y, x1 - x0 + 1,
+                             y1 - y0 + 1, TFT_WHITE);
+            _marker.atlas.draw(
+                canvas, _roi_label[&roi - param->roi_rect].text,
+                _client_rect.x + x0 + 1, _client_rect.y + y0 + 1 - canvas_y,
+                (uint16_t)TFT_WHITE, (uint16_t)TFT_BLACK);
         }
+
         if (draw_param.misc_pointer !=
             draw_param.misc_pointer_t::misc_pointer_off) {
             int y = _marker.mark_y + _client_rect.y - canvas_y;
@@ -2303,13 +3160,14 @@ class image_ui_t : public ui_base_t {
                 misc_pointer_pointtxt) {  // ||
                                           // draw_param.show_reference_name)
                                           // {
-            int32_t marker_h = _marker.txtimg.height();
+            int32_t marker_h = _marker.text_h;
             int32_t y        = _client_rect.y + _marker.text_y - canvas_y;
             if (((y - marker_h) << 1) < canvas->height()) {
                 int32_t x = _client_rect.x + _marker.text_x;
-                _marker.txtimg.pushSprite(canvas,
-                                          x - (_marker.txtimg.width() >> 1),
-                                          y - (marker_h >> 1), 0);
+                _marker.atlas.draw(canvas, _marker.text,
+                                   x - (_marker.text_w >> 1),
+                                   y - (marker_h >> 1), (uint16_t)TFT_WHITE,
+                                   (uint16_t)TFT_BLACK);
             }
         }
     }
@@ -2322,36 +3180,208 @@ class graph_ui_t : public ui_base_t {
     int32_t _step_raw;
     uint8_t _last_update_count;
 
+    // 各行の背景色と目盛りの数値。表示範囲・目盛り・色・高さが変わった時
+    // だけ求め直し、帯ごとの描画とグラフ面の描画で共用する
+    struct label_t {
+        int16_t y;
+        int16_t value;
+        uint16_t color;
+    };
+    std::vector<label_t> _labels;
+    std::vector<uint16_t> _row_color;  // 各行の背景色 (目盛り線の行は線の色)
+    std::vector<uint16_t> _row_dot;    // 各行の点線の色
+    int32_t _rows_lowest          = 0;
+    int32_t _rows_highest         = 0;
+    int32_t _rows_step            = 0;
+    const uint16_t* _rows_palette = nullptr;
+    int16_t _rows_height          = 0;
+    uint8_t _rows_modify          = 0;
+    uint8_t _rows_font_height     = 0;
+
+    // 背景・目盛り線・折れ線を描いたグラフ面 (描画バッファと同じ色深度)。
+    // 新しい点の数だけ左へスクロールして右端の列を描き足す。
+    // 移動・拡大縮小中や、大きすぎる・ヒープに余裕がない場合は持たずに
+    // 帯ごとに描く
+    static constexpr const size_t surface_max_bytes    = 16384;
+    static constexpr const size_t surface_heap_reserve = 40960;
+    M5Canvas _surface;
+    const graph_history_t* _surface_history = nullptr;
+    uint16_t _surface_count                 = 0;
+    uint8_t _surface_index                  = 0;
+    bool _surface_valid                     = false;
+    bool _use_surface                       = false;
+
+    int32_t sampleY(int32_t raw) const {
+        int32_t graph_temp_diff = _range_highest - _range_lowest + 1;
+        return _client_rect.h -
+               (1 + (int32_t)((raw - _range_lowest) * _client_rect.h) /
+                        graph_temp_diff);
+    }
+
+    bool updateRows(draw_param_t* param) {
+        int32_t h = _client_rect.h;
+        if (_rows_lowest == _range_lowest && _rows_highest == _range_highest &&
+            _rows_step == _step_raw && _rows_palette == param->color_map &&
+            _rows_height == h && _rows_modify == param->modify_count &&
+            _rows_font_height == param->font_height) {
+            return false;
+        }
+        _rows_lowest      = _range_lowest;
+        _rows_highest     = _range_highest;
+        _rows_step        = _step_raw;
+        _rows_palette     = param->color_map;
+        _rows_height      = h;
+        _rows_modify      = param->modify_count;
+        _rows_font_height = param->font_height;
+        _row_color.resize(h);
+        _row_dot.resize(h);
+
+        int32_t graph_temp_diff = _range_highest - _range_lowest + 1;
+        int32_t label_end       = h + param->font_height;
+        int32_t raw             = graph_temp_diff + _range_lowest;
+        int32_t line_idx        = (raw - raw_step_offset) / _step_raw;
+        _labels.clear();
+        for (int32_t y = 0; y < label_end; ++y) {
+            int32_t prev_idx = line_idx;
+            int32_t i        = h - (y + 1);
+            raw = (i * graph_temp_diff / h) + _range_lowest;
+            line_idx         = (raw - raw_step_offset) / _step_raw;
+            uint16_t color   = m5gfx::getSwap16(
+                param->color_lut[param->getColorIndex(raw)]);
+            uint16_t bgcolor = (color >> 2) & 0x39E7;
+            if (y < h) {
+                _row_dot[y]   = bgcolor + 0x2104;
+                _row_color[y] = (prev_idx == line_idx) ? bgcolor : _row_dot[y];
+            }
+            if (prev_idx != line_idx) {
+                int gauge_value = convertRawToCelsius(prev_idx * _step_raw +
+                                                      raw_step_offset);
+                _labels.push_back({(int16_t)y, (int16_t)gauge_value,
+                                   (uint16_t)(((color >> 1) & 0x7BEF) +
+                                              0x630C)});
+            }
+        }
+        return true;
+    }
+
+    // 背景と点線の x0~x1, y0~y1 (グラフ内の座標) を (ox, oy) を原点に描く
+    void plotBackground(LovyanGFX* gfx, int32_t ox, int32_t oy, int32_t x0,
+                        int32_t x1, int32_t y0, int32_t y1) const {
+        int32_t dot = x0 + ((_client_rect.w - (_current_index & 15) - x0) & 15);
+        for (int32_t y = y0; y < y1; ++y) {
+            gfx->drawFastHLine(ox + x0, oy + y, x1 - x0, _row_color[y]);
+            gfx->setColor(_row_dot[y]);
+            for (int32_t x = dot; x < x1; x += 16) {
+                gfx->drawPixel(ox + x, oy + y);
+            }
+        }
+    }
+
+    // 折れ線の x0~x1 の列を (ox, oy) を原点に描く
+    void plotLines(LovyanGFX* gfx, int32_t ox, int32_t oy,
+                   const graph_history_t* history, int32_t x0,
+                   int32_t x1) const {
+        for (int i = 0; i < 4; ++i) {
+            const uint16_t* temp_array = history->temp_arrays[i];
+            if (temp_array == nullptr) continue;
+            gfx->setColor(graph_color_table[i]);
+            uint8_t idx = _current_index - _client_rect.w + x0;
+            int y       = sampleY(temp_array[idx]);
+            for (int32_t x = x0; x < x1; ++x) {
+                int prev_y = y;
+                y          = sampleY(temp_array[++idx]);
+                int y0     = (y < prev_y) ? y : prev_y;
+                int y1     = (y > prev_y) ? y : prev_y;
+                gfx->fillRect(ox + x, oy + y0, 1, y1 - y0 + 1);
+            }
+        }
+    }
+
+    void releaseSurface(void) {
+        _surface.deleteSprite();
+        _surface_valid = false;
+        _use_surface   = false;
+    }
+
+    void updateSurface(draw_param_t* param, const graph_history_t* history,
+                       bool rows_changed) {
+        _use_surface = _client_rect == _target_rect;
+        if (!_use_surface) {
+            return;
+        }
+        int32_t w     = _client_rect.w;
+        int32_t h     = _client_rect.h;
+        int32_t depth = (param->misc_drawbuf == param->misc_drawbuf_8bit)
+                            ? 8
+                            : 16;
+        if (_surface.width() != w || _surface.height() != h ||
+            _surface.getColorDepth() != depth) {
+            releaseSurface();
+            size_t bytes = w * h * depth >> 3;
+            if (bytes > surface_max_bytes ||
+                heap_caps_get_free_size(MALLOC_CAP_8BIT) <
+                    bytes + surface_heap_reserve) {
+                return;
+            }
+            _surface.setPsram(false);
+            _surface.setColorDepth(depth);
+            if (!_surface.createSprite(w, h)) {
+                return;
+            }
+            _use_surface = true;
+        }
+
+        uint8_t add = _current_index - _surface_index;
+        bool full   = !_surface_valid || rows_changed || add >= w ||
+                    _surface_history != history ||
+                    _surface_count > history->count;
+        _surface_valid   = true;
+        _surface_history = history;
+        _surface_count   = history->count;
+        _surface_index   = _current_index;
+        if (full) {
+            plotBackground(&_surface, 0, 0, 0, w, 0, h);
+            plotLines(&_surface, 0, 0, history, 0, w);
+        } else if (add) {
+            _surface.scroll(-add, 0);
+            plotBackground(&_surface, 0, 0, w - add, w, 0, h);
+            plotLines(&_surface, 0, 0, history, w - add, w);
+        }
+    }
+
    public:
     void setup(draw_param_t* param) {
         _range_lowest  = param->frame->temp[framedata_t::lowest];
         _range_highest = param->frame->temp[framedata_t::highest];
     }
 
+    bool isDamageTracked(void) const override {
+        return true;
+    }
+    bool isParallelDrawable(void) const override {
+        return true;
+    }
+
     void update(draw_param_t* param) override {
-        _current_index = param->graph_data.current_idx;
+        auto history = &param->graph_data.history[param->misc_graphspan];
+        if (_current_index != history->current_idx || checkModified(param)) {
+            _current_index = history->current_idx;
+            invalidate();
+        }
 
         if (!_client_rect.empty()) {  // Obtain the maximum and minimum values
                                       // within the displayed range.
-            int32_t t0  = UINT16_MAX;
-            int32_t t1  = 0;
-            uint8_t idx = _current_index - _client_rect.w;
-            for (int i = 0; i < _client_rect.w; ++i) {
-                t0 = std::min<int32_t>(
-                    t0,
-                    param->graph_data.temp_arrays[framedata_t::lowest][idx]);
-                t1 = std::max<int32_t>(
-                    t1,
-                    param->graph_data.temp_arrays[framedata_t::highest][idx]);
-                ++idx;
-            }
+            // 描画する w+1 点分の範囲を単調キューで保持させる
+            history->setWindow(_client_rect.w + 1);
+            int32_t t0 = history->getLowest();
+            int32_t t1 = history->getHighest();
             int32_t diff    = (t1 - t0) >> 3;
             int32_t new_low = (_range_lowest * 3 + t0 - diff) >> 2;
             if (new_low < 0) new_low = 0;
             int32_t new_high = (_range_highest * 3 + t1 + diff + 3) >> 2;
             if (new_high > UINT16_MAX) new_high = UINT16_MAX;
             if (new_low != _range_lowest || new_high != _range_highest) {
-                // invalidate();
+                invalidate();
                 _range_lowest  = new_low;
                 _range_highest = new_high;
             }
@@ -2365,83 +3395,38 @@ class graph_ui_t : public ui_base_t {
                 ++step_index;
             }
             _step_raw = step_table[step_index] * 128;
+            updateSurface(param, history, updateRows(param));
+        } else if (_surface.getBuffer()) {
+            releaseSurface();
         }
     }
 
     void draw(draw_param_t* param, M5Canvas* canvas, int32_t canvas_y,
               int32_t h) override {
-        int32_t graph_temp_diff = _range_highest - _range_lowest + 1;
-
-        {
-            int32_t xs = _current_index & 15;
-            int ystart = canvas_y - _client_rect.y;
-            int yend   = ystart + h;
-
-            canvas->setTextDatum(textdatum_t::bottom_left);
-            canvas->setTextSize(1);
-            int fontHeight = draw_param.font_height;
-
-            int32_t raw =
-                ((_client_rect.h - ystart) * graph_temp_diff / _client_rect.h) +
-                _range_lowest;
-            int32_t line_idx = (raw - raw_step_offset) / _step_raw;
-            for (int y = ystart; y < yend + fontHeight; ++y) {
-                int32_t prev_raw = line_idx;
-                int32_t i        = _client_rect.h - (y + 1);
-                raw = (i * graph_temp_diff / _client_rect.h) + _range_lowest;
-                int v =
-                    ((raw - param->range_temp_lower) << 8) / param->temp_diff;
-                line_idx         = (raw - raw_step_offset) / _step_raw;
-                v                = (v < 0) ? 0 : (v > 255) ? 255 : v;
-                uint16_t color   = param->color_map[v];
-                uint16_t bgcolor = (color >> 2) & 0x39E7;
-                int32_t draw_y   = y + _client_rect.y - canvas_y;
-                if (prev_raw == line_idx) {
-                    if (draw_y < h) {
-                        canvas->drawFastHLine(_client_rect.x, draw_y,
-                                              _client_rect.w, bgcolor);
-                        canvas->setColor(bgcolor + 0x2104);
-                        for (int x = _client_rect.w - xs; x >= 0; x -= 16) {
-                            canvas->drawPixel(_client_rect.x + x, draw_y);
-                        }
-                    }
-                } else {
-                    int gauge_value = convertRawToCelsius(prev_raw * _step_raw +
-                                                          raw_step_offset);
-                    canvas->setTextColor(((color >> 1) & 0x7BEF) + 0x630C);
-                    canvas->drawNumber(gauge_value, _client_rect.x + 1, draw_y);
-                    if (draw_y >= h) {
-                        break;
-                    }
-                    canvas->drawFastHLine(_client_rect.x, draw_y,
-                                          _client_rect.w, bgcolor + 0x2104);
-                }
-            }
+        auto history = &param->graph_data.history[param->misc_graphspan];
+        int32_t ox   = _client_rect.x;
+        int32_t oy   = _client_rect.y - canvas_y;
+        if (_use_surface) {
+            _surface.pushSprite(canvas, ox, oy);
+        } else {
+            int32_t y0 = (oy < 0) ? -oy : 0;
+            int32_t y1 = h - oy;
+            if (y1 > _client_rect.h) y1 = _client_rect.h;
+            plotBackground(canvas, ox, oy, 0, _client_rect.w, y0, y1);
+            plotLines(canvas, ox, oy, history, 0, _client_rect.w);
+        }
 
-            for (int i = 0; i < 4; ++i) {
-                uint8_t idx = (_current_index - _client_rect.w);
-                canvas->setColor(graph_color_table[i]);
-                int y = _client_rect.h -
-                        (1 + (int32_t)((param->graph_data.temp_arrays[i][idx] -
-                                        _range_lowest) *
-                                       _client_rect.h) /
-                                 graph_temp_diff);
-                for (int gi = 0; gi < _client_rect.w; ++gi) {
-                    uint8_t prev_idx = idx;
-                    ++idx;
-                    int prev_y = y;
-                    y          = _client_rect.h -
-                        (1 + (int32_t)((param->graph_data.temp_arrays[i][idx] -
-                                        _range_lowest) *
-                                       _client_rect.h) /
-                                 graph_temp_diff);
-                    int y0 = (y < prev_y) ? y : prev_y;
-                    int y1 = (y > prev_y) ? y : prev_y;
-                    canvas->fillRect(_client_rect.x + gi,
-                                     _client_rect.y + y0 - canvas_y, 1,
-                                     y1 - y0 + 1);
-                }
+        // 目盛りの数値はスクロールしないため常に重ねて描く
+        int32_t ystart = -oy;
+        int32_t yend   = ystart + h + param->font_height;
+        canvas->setTextDatum(textdatum_t::bottom_left);
+        canvas->setTextSize(1);
+        for (auto& label : _labels) {
+            if (label.y < ystart || label.y >= yend) {
+                continue;
             }
+            canvas->setTextColor(label.color);
+            canvas->drawNumber(label.value, ox + 1, oy + label.y);
         }
     }
 };
@@ -2456,10 +3441,20 @@ class infotext_ui_t : public ui_base_t {
     bool _draw_title  = false;
     float _textsize_x = 1.0f;
     float _textsize_y = 1.0f;
+    bool _use_atlas   = false;
+    // 数値はレイアウトやフォントが変わった時だけ作り直す atlas から並べる
+    glyph_atlas_t _atlas;
 
    public:
+    bool isDamageTracked(void) const override {
+        return true;
+    }
+    bool isParallelDrawable(void) const override {
+        return true;
+    }
+
     void update(draw_param_t* param) override {
-        if (isModified(param)) {
+        if (checkModified(param)) {
             for (int i = 0; i < _text_count; ++i) {
                 float ftmp = convertRawToCelsius(param->frame->temp[i]);
                 int tmp =
@@ -2470,6 +3465,7 @@ class infotext_ui_t : public ui_base_t {
                     _value_x10[i] = tmp;
                     snprintf(_value_text[i], sizeof(_value_text[0]), "%5.1f",
                              ftmp);
+                    invalidate();
                 }
             }
         }
@@ -2495,6 +3491,17 @@ class infotext_ui_t : public ui_base_t {
             _textsize_x = sw1 < 1.0f ? 1.0f : sw1;
             _textsize_y = sh * 2;
         }
+        // 移動・拡大縮小中は倍率が毎回変わるため atlas を作らず文字を直接描く。
+        // 領域が目標位置に収まった時の倍率 (= _target_rect の倍率) で作る
+        bool use_atlas = _client_rect == _target_rect;
+        if (_use_atlas != use_atlas) {
+            _use_atlas = use_atlas;
+            invalidate();
+        }
+        if (use_atlas &&
+            _atlas.build(draw_param.font, _textsize_x, _textsize_y, false)) {
+            invalidate();
+        }
     }
 
     void draw(draw_param_t* param, M5Canvas* canvas, int32_t canvas_y,
@@ -2511,15 +3518,22 @@ class infotext_ui_t : public ui_base_t {
                                        canvas_y);
             }
 
-            canvas->setTextSize(_textsize_x, _textsize_y);
-            canvas->setTextDatum(textdatum_t::top_right);
             int32_t y0 = _client_rect.h * (i) / _text_count;
             if (_two_line) {
                 int32_t y1 = _client_rect.h * (i + 1) / _text_count;
                 y0         = (y1 + y0) / 2;
             }
-            canvas->drawString(_value_text[i], _client_rect.right(),
-                               _client_rect.y + y0 - canvas_y);
+            if (_use_atlas) {
+                _atlas.draw(
+                    canvas, _value_text[i],
+                    _client_rect.right() - _atlas.textWidth(_value_text[i]),
+                    _client_rect.y + y0 - canvas_y, graph_color_table[i]);
+            } else {
+                canvas->setTextSize(_textsize_x, _textsize_y);
+                canvas->setTextDatum(textdatum_t::top_right);
+                canvas->drawString(_value_text[i], _client_rect.right(),
+                                   _client_rect.y + y0 - canvas_y);
+            }
         }
     }
 };
@@ -2531,10 +3545,20 @@ class hist_ui_t : public ui_base_t {
     uint16_t _hist_len     = 0;
 
    public:
+    bool isDamageTracked(void) const override {
+        return true;
+    }
+    bool isParallelDrawable(void) const override {
+        return true;
+    }
+
     void update(draw_param_t* param) override {
         if (_client_rect.empty()) {
             return;
         }
+        if (checkModified(param)) {
+            invalidate();
+        }
 
         int hist_len = _client_rect.h;
         if (_hist_len != hist_len) {
@@ -2556,21 +3580,50 @@ class hist_ui_t : public ui_base_t {
 
         memset(_histgram, 0, _hist_len * sizeof(_histgram[0]));
 
-        {  // Histogram Aggregation.
+        // フレームごとに集計済みのヒストグラムを表示行に割り振る
+        auto hist = &param->frame->histogram;
+        if (hist->total) {
             int hist_max  = _hist_len - 1;
             int temp_low  = param->range_temp_lower;
             int temp_diff = param->temp_diff;
-            for (int idx = 0; idx < frame_width * frame_height; ++idx) {
-                int hist_idx =
-                    (param->frame->pixel_raw[idx] - temp_low) * (hist_max + 1);
-                hist_idx = (hist_idx << 6) / temp_diff;
-                int rate = hist_idx & 63;
-                hist_idx >>= 6;
-                hist_idx = (hist_idx < 0)          ? 0
-                           : (hist_idx > hist_max) ? hist_max
-                                                   : hist_idx;
-                _histgram[hist_idx] += 64 - rate;
-                _histgram[++hist_idx > hist_max ? hist_max : hist_idx] += rate;
+            // 1ピクセルあたり64 (全ピクセル数に換算した重み)
+            uint32_t unit = (64 * frame_width * frame_height) / hist->total;
+            // 位置は 1/64 行単位
+            int32_t p1 = ((hist->base - temp_low) * _hist_len << 6) / temp_diff;
+            for (int32_t b = 0; b < (int32_t)hist->bin_count; ++b) {
+                int32_t p0 = p1;
+                p1 = ((hist->base + ((b + 1) << hist->shift) - temp_low) *
+                          _hist_len
+                      << 6) /
+                     temp_diff;
+                uint32_t weight = hist->bins[b] * unit;
+                if (weight == 0) continue;
+
+                // ビンの幅に応じて複数行へ均等に配分する。
+                // 表示範囲外の分は端の行に加算する。
+                int32_t len = p1 - p0;
+                if (len <= 0) {
+                    int r = p0 >> 6;
+                    r     = (r < 0) ? 0 : (r > hist_max) ? hist_max : r;
+                    _histgram[r] += weight;
+                    continue;
+                }
+                for (int32_t p = p0; p < p1;) {
+                    int32_t r    = p >> 6;
+                    int32_t next = (r + 1) << 6;
+                    if (r < 0) {
+                        r    = 0;
+                        next = 0;
+                    } else if (r > hist_max) {
+                        r    = hist_max;
+                        next = p1;
+                    }
+                    if (next > p1) {
+                        next = p1;
+                    }
+                    _histgram[r] += ((int64_t)weight * (next - p)) / len;
+                    p = next;
+                }
             }
         }
     }
@@ -2609,9 +3662,12 @@ class hist_ui_t : public ui_base_t {
             raw              = ((i * param->temp_diff / drawHeight) +
                    param->range_temp_lower - raw_step_offset) /
                   _step_raw;
-            bool drawline = (prev_raw != raw);
-            uint16_t color =
-                param->color_map[((i < 0 ? 0 : i) << 8) / (drawHeight + 1)];
+            bool drawline   = (prev_raw != raw);
+            int32_t row_raw = param->range_temp_lower +
+                              (i < 0 ? 0 : i) * param->temp_diff /
+                                  (drawHeight + 1);
+            uint16_t color  = m5gfx::getSwap16(
+                param->color_lut[param->getColorIndex(row_raw)]);
             if (drawline) {
                 int gauge_value =
                     convertRawToCelsius(prev_raw * _step_raw + raw_step_offset);
@@ -2897,27 +3953,84 @@ uint8_t changeLayout(uint8_t layout_idx) {
     return layout_idx;
 }
 
+// 画面の帯 (y から h 行) を canvas に描画する。
+// ui_mask は描画する UI (ui_list の添字のビット)
+static void renderBand(ui_base_t* const* ui_list, size_t ui_count,
+                       uint32_t ui_mask, M5Canvas* canvas, int32_t y,
+                       int32_t h) {
+    canvas->clearClipRect();
+    canvas->fillScreen(draw_param.background_color);
+    int32_t dummy, wid, hei;
+    for (size_t i = 0; i < ui_count; ++i) {
+        if (!(ui_mask & (1u << i))) {
+            continue;
+        }
+        auto ui   = ui_list[i];
+        auto rect = ui->getClientRect();
+        if (rect.empty()) {
+            continue;
+        }
+        canvas->setClipRect(rect.x, rect.y - y, rect.w, rect.h);
+        canvas->getClipRect(&dummy, &dummy, &wid, &hei);
+        if (wid <= 0 || hei <= 0) {
+            continue;
+        }
+
+        ui->draw(&draw_param, canvas, y, h);
+    }
+}
+
+// 2コア描画時に帯の描画を分担する補助タスク (APP_CPU)
+static struct draw_worker_t {
+    TaskHandle_t task       = nullptr;
+    SemaphoreHandle_t start = nullptr;
+    SemaphoreHandle_t done  = nullptr;
+    ui_base_t* const* ui_list;
+    size_t ui_count;
+    uint32_t ui_mask;
+    M5Canvas* canvas;
+    int32_t y;
+    int32_t h;
+} draw_worker;
+
+static void drawWorkerTask(void*) {
+    for (;;) {
+        xSemaphoreTake(draw_worker.start, portMAX_DELAY);
+        renderBand(draw_worker.ui_list, draw_worker.ui_count,
+                   draw_worker.ui_mask, draw_worker.canvas, draw_worker.y,
+                   draw_worker.h);
+        xSemaphoreGive(draw_worker.done);
+    }
+}
+
 void drawTask(void*) {
     ui_base_t* ui_list[] = {&battery_ui, &text_ui,   &hist_ui,
                             &image_ui,   &graph_ui,  &config_ui,
                             &header_ui,  &qrcode_ui, &overlay_ui};
-    static constexpr const uint32_t disp_buf_height = 16;
     static constexpr const size_t disp_buf_count =
         3;  // 描画バッファの数。jpegエンコーダのqueueにセットする分があるため3とする
     M5Canvas disp_buf[disp_buf_count];
-    uint8_t disp_buf_idx   = 0;
-    uint8_t disp_queue_idx = 0;
+    uint32_t disp_buf_height = 16;
+    uint8_t disp_buf_idx     = 0;
+    uint8_t disp_queue_idx   = 0;
 
     int32_t disp_width  = display.width();
     int32_t disp_height = display.height();
-    auto depth          = display.getColorDepth();
-    for (int i = 0; i < disp_buf_count; ++i) {
-        disp_buf[i].deleteSprite();
-        disp_buf[i].setPsram(false);
-        disp_buf[i].setColorDepth(depth);
-        disp_buf[i].createSprite(disp_width, disp_buf_height);
-        disp_buf[i].startWrite();
-    }
+
+    // 8bit 描画バッファでは同じメモリ量で帯の行数を2倍にする
+    uint8_t prev_drawbuf = draw_param.misc_drawbuf;
+    auto create_disp_buf = [&](void) {
+        bool depth8     = prev_drawbuf == draw_param.misc_drawbuf_8bit;
+        disp_buf_height = depth8 ? 32 : 16;
+        for (int i = 0; i < disp_buf_count; ++i) {
+            disp_buf[i].deleteSprite();
+            disp_buf[i].setPsram(false);
+            disp_buf[i].setColorDepth(depth8 ? 8 : display.getColorDepth());
+            disp_buf[i].createSprite(disp_width, disp_buf_height);
+            disp_buf[i].startWrite();
+        }
+    };
+    create_disp_buf();
     {
         rect_t rect = {disp_width >> 1, disp_height >> 1, 0, 0};
         for (auto ui : ui_list) {
@@ -2940,9 +4053,43 @@ void drawTask(void*) {
 
     uint8_t prev_layout = 255;
 
+    // 描画はフレームの到着 (タスク通知) 時と、アニメーション用の周期で行う。
+    // 変化する領域がない間は周期を idle_tick_msec まで延ばす。
+    // フレームが短い間隔で続く場合も描画の間隔は frame_min_msec 以上空ける
+    static constexpr const uint32_t anim_tick_msec = 30;
+    static constexpr const uint32_t idle_tick_msec = 200;
+    static constexpr const int32_t frame_min_msec  = 20;
+    uint32_t tick_msec                             = anim_tick_msec;
+
+    // 画面に変化がない場合の描画間隔 (msec)
+    static constexpr const uint32_t idle_draw_msec = 960;
+    uint32_t prev_scene_change = 0;
+    uint32_t prev_draw         = 0;
+    uint8_t prev_input         = 0;
+    uint8_t prev_modify        = 0;
+    bool prev_headless         = false;
+
+    // 帯 (disp_buf_height 行) ごとの描画対象 UI (ui_list の添字のビット) と、
+    // 描き直しが必要な帯のビット。画面の高さは 32帯 以内とする
+    static constexpr const size_t ui_count = SIZEOF_ARRAY(ui_list);
+    static constexpr const size_t band_max = 32;
+    uint32_t band_count = (disp_height + disp_buf_height - 1) / disp_buf_height;
+    uint32_t band_ui[band_max];
+    uint32_t band_parallel = 0;  // 2コアで同時に描画できる帯のビット
+    uint32_t dirty_band    = ~0u;
+    bool band_ui_valid     = false;
+    auto band_mask      = [&](const rect_t& r) -> uint32_t {
+        if (r.empty() || r.bottom() <= 0 || r.top() >= disp_height) {
+            return 0;
+        }
+        int32_t bottom = (r.bottom() < disp_height) ? r.bottom() : disp_height;
+        int32_t b0     = (r.top() < 0) ? 0 : r.top() / disp_buf_height;
+        int32_t b1     = (bottom - 1) / disp_buf_height;
+        return ((2u << b1) - 1) & ~((1u << b0) - 1);
+    };
+
     display.startWrite();
     for (;;) {
-        ++draw_param.draw_count;
 
         // {
         //     auto r = config_ui.getTargetRect();
@@ -2966,10 +4113,23 @@ void drawTask(void*) {
         //         disp_buf[i].createSprite(disp_width, disp_buf_height);
         //     }
         // }
+        if (prev_drawbuf != draw_param.misc_drawbuf) {
+            // JPEGエンコーダが読んでいるバッファを作り直さないよう待つ
+            prev_drawbuf = draw_param.misc_drawbuf;
+            screenshot_holder.waitQueue();
+            create_disp_buf();
+            band_ui_valid = false;
+            dirty_band    = ~0u;
+            for (int i = 0; i < disp_buf_count; ++i) {
+                disp_buf[i].setFont(draw_param.font);
+            }
+            band_count = (disp_height + disp_buf_height - 1) / disp_buf_height;
+        }
         if (disp_buf[0].getFont() != draw_param.font) {
             for (int i = 0; i < disp_buf_count; ++i) {
                 disp_buf[i].setFont(draw_param.font);
             }
+            dirty_band = ~0u;
         }
         // if (prev_color_table_idx != color_map_table_idx) {
         //     prev_color_table_idx = color_map_table_idx;
@@ -2985,81 +4145,198 @@ void drawTask(void*) {
 
         uint32_t msec = millis();
         uint8_t wdt   = msec >> 6;
-        prev_msec += 30;
-        int32_t limit_delay = prev_msec - msec;
         if (prev_wdt != wdt) {
+            // 通知が続いてもアイドルタスクが動けるよう定期的に待機する
             prev_wdt = wdt;
-            if (limit_delay <= 0) {
-                limit_delay = 1;
-            }
+            delay(1);
+            msec = millis();
         }
-        if (limit_delay > 0) {
-            delay(limit_delay);
-        } else {
-            prev_msec += (-limit_delay) >> 1;
+        int32_t wait = (int32_t)(prev_msec + tick_msec - msec);
+        if (wait > 0) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait));
+            msec = millis();
         }
+        int32_t gap = frame_min_msec - (int32_t)(msec - prev_msec);
+        if (gap > 0) {
+            delay(gap);
+            msec = millis();
+        }
+        prev_msec = msec;
+        ++draw_param.draw_count;
 
-        for (auto ui : ui_list) {
-            ui->smoothMove();
+        bool headless = draw_param.misc_headless;
+        if (prev_headless != headless) {
+            prev_headless = headless;
+            if (headless) {
+                display.setBrightness(0);
+                display.sleep();
+            } else {
+                size_t idx = draw_param.misc_brightness;
+                display.wakeup();
+                display.setBrightness(draw_param.misc_brightness_value[idx]);
+                dirty_band = ~0u;
+            }
         }
 
         draw_param.range_update();
         if (draw_param.update(idx_recv)) {
         }
+
+        // 無表示モードでは JPEG配信の要求がある場合のみ描画する
+        if (headless && !screenshot_holder.isPending()) {
+            tick_msec = idle_tick_msec;
+            draw_param.busy_meter[draw_param.busy_ui].add(0, msec);
+            draw_param.busy_meter[draw_param.busy_render].add(0, msec);
+            continue;
+        }
+
+        uint32_t usec = micros();
+        draw_param.updateColorLut();
+        bool moving = false;
+        for (auto ui : ui_list) {
+            moving |= ui->smoothMove();
+        }
         for (auto ui : ui_list) {
             ui->update(&draw_param);
         }
-        uint32_t h = disp_buf_height;
+        draw_param.busy_meter[draw_param.busy_ui].add(micros() - usec, msec);
+
+        // 変化した領域を含む帯を記録する。描画を間引いた場合は次回へ持ち越す
+        if (moving || !band_ui_valid) {
+            band_ui_valid = true;
+            band_parallel = ~0u;
+            memset(band_ui, 0, sizeof(band_ui));
+            for (size_t i = 0; i < ui_count; ++i) {
+                uint32_t mask = band_mask(ui_list[i]->getClientRect());
+                for (uint32_t b = 0; b < band_count; ++b) {
+                    if (mask & (1u << b)) {
+                        band_ui[b] |= 1u << i;
+                    }
+                }
+                if (!ui_list[i]->isParallelDrawable()) {
+                    band_parallel &= ~mask;
+                }
+            }
+        }
+        for (auto ui : ui_list) {
+            if (!ui->isDamageTracked()) {
+                ui->invalidate();
+            }
+            dirty_band |= band_mask(ui->getInvalidRect());
+            ui->clearInvalidate();
+        }
+        // 設定変更の直後は全体を描き直す
+        if (config_save_countdown) {
+            dirty_band = ~0u;
+        }
+        tick_msec = (dirty_band || moving) ? anim_tick_msec : idle_tick_msec;
+
+        // 静止したシーンでは描画とJPEG配信を間引く
+        if (draw_param.sens_scenegate && !moving &&
+            !draw_param.in_config_mode && !config_save_countdown &&
+            prev_scene_change == draw_param.scene_change_count &&
+            prev_input == draw_param.input_count &&
+            prev_modify == draw_param.modify_count &&
+            (msec - prev_draw) < idle_draw_msec) {
+            draw_param.busy_meter[draw_param.busy_render].add(0, msec);
+            continue;
+        }
+        prev_scene_change = draw_param.scene_change_count;
+        prev_input        = draw_param.input_count;
+        prev_modify       = draw_param.modify_count;
+        prev_draw         = msec;
+        usec              = micros();
         if (prev_misc_staff != (bool)draw_param.misc_staff) {
             prev_misc_staff = !prev_misc_staff;
             if (prev_misc_staff) {
                 display.drawJpg(jpg_staff, sizeof(jpg_staff), 0, 0,
                                 display.width(), display.height(), 0, 0, 1.0f,
                                 1.0f, datum_t::middle_center);
+            } else {
+                dirty_band = ~0u;
             }
         }
 
         bool screenshot =
             screenshot_holder.initCapture(disp_width, disp_height);
-        for (uint32_t y = 0; y < disp_height; y += h) {
-            if (h >= disp_height - y) {
-                h = disp_height - y;
+
+        // 描画する帯。JPEG配信時は全ての帯が必要になる
+        uint8_t bands[band_max];
+        size_t band_len = 0;
+        for (uint32_t b = 0; b < band_count; ++b) {
+            if (screenshot || (dirty_band & (1u << b))) {
+                bands[band_len++] = b;
             }
+        }
+
+        bool dual = draw_param.misc_dualcore;
+        if (dual && !draw_worker.task) {
+            draw_worker.start = xSemaphoreCreateBinary();
+            draw_worker.done  = xSemaphoreCreateBinary();
+            xTaskCreatePinnedToCore(drawWorkerTask, "drawWorker", 4096,
+                                    nullptr, 2, &draw_worker.task,
+                                    APP_CPU_NUM);
+        }
 
+        auto next_canvas = [&](void) -> M5Canvas* {
             do {
                 disp_buf_idx =
                     (disp_buf_idx < disp_buf_count - 1) ? disp_buf_idx + 1 : 0;
                 // JPGストリームキュー待機中のバッファの使用を避ける
                 // これにより、通信エラー時にブラウザの表示画像が乱れることを防止する
             } while (disp_buf_idx == disp_queue_idx);
-
-            auto canvas = &disp_buf[disp_buf_idx];
-            canvas->clearClipRect();
-            canvas->fillScreen(draw_param.background_color);
-            int32_t dummy, wid, hei;
-            for (auto ui : ui_list) {
-                auto rect = ui->getClientRect();
-                if (rect.empty()) {
-                    continue;
-                }
-                canvas->setClipRect(rect.x, rect.y - y, rect.w, rect.h);
-                canvas->getClipRect(&dummy, &dummy, &wid, &hei);
-                if (wid <= 0 || hei <= 0) {
-                    continue;
-                }
-
-                ui->draw(&draw_param, canvas, y, h);
-            }
-            if (!prev_misc_staff) {
+            return &disp_buf[disp_buf_idx];
+        };
+        // 描画済みの帯を上から順に画面とJPEGエンコーダへ渡す
+        auto output_band = [&](M5Canvas* canvas, int32_t y) {
+            if (!prev_misc_staff && !headless) {
                 canvas->pushSprite(&display, 0, y);
             }
             if (screenshot) {
                 screenshot = screenshot_holder.addQueue(canvas, y);
                 if (screenshot) {
-                    disp_queue_idx = disp_buf_idx;
+                    disp_queue_idx = canvas - disp_buf;
                 }
             }
+        };
+        auto band_height = [&](int32_t y) -> int32_t {
+            return (disp_height - y < (int32_t)disp_buf_height)
+                       ? disp_height - y
+                       : disp_buf_height;
+        };
+
+        for (size_t i = 0; i < band_len; ++i) {
+            uint32_t b0 = bands[i];
+            int32_t y0  = b0 * disp_buf_height;
+            auto c0     = next_canvas();
+
+            // 続く帯も2コアで描画できる場合は補助タスクに描画させる。
+            // キュー待機中のバッファは next_canvas で除外される
+            M5Canvas* c1 = nullptr;
+            if (dual && i + 1 < band_len && (band_parallel & (1u << b0)) &&
+                (band_parallel & (1u << bands[i + 1]))) {
+                uint32_t b1          = bands[++i];
+                c1                   = next_canvas();
+                draw_worker.ui_list  = ui_list;
+                draw_worker.ui_count = ui_count;
+                draw_worker.ui_mask  = band_ui[b1];
+                draw_worker.canvas   = c1;
+                draw_worker.y        = b1 * disp_buf_height;
+                draw_worker.h        = band_height(draw_worker.y);
+                xSemaphoreGive(draw_worker.start);
+            }
+
+            renderBand(ui_list, ui_count, band_ui[b0], c0, y0,
+                       band_height(y0));
+            output_band(c0, y0);
+            if (c1) {
+                xSemaphoreTake(draw_worker.done, portMAX_DELAY);
+                output_band(c1, draw_worker.y);
+            }
         }
+        dirty_band = 0;
+        draw_param.busy_meter[draw_param.busy_render].add(micros() - usec,
+                                                          msec);
     }
     display.endWrite();
 }
@@ -3076,6 +4353,13 @@ static bool sync_rtc_ntp(void) {
 
 // volatile bool requestWiFi = false;
 
+// 前回接続したアクセスポイント。再接続時にスキャンを省いて接続時間を短くする
+// (ライトスリープ中もRAMは保持される)
+static struct wifi_cache_t {
+    uint8_t bssid[6];
+    int32_t channel = 0;
+} wifi_cache;
+
 static void wifiTask(void*) {
     bool rtc_sync = false;
     config_param_t::net_setup_mode_t prev_net_setup_mode =
@@ -3093,6 +4377,9 @@ static void wifiTask(void*) {
                 connecting_retry = 0;
             } else {
                 soundWiFiConnected();
+                memcpy(wifi_cache.bssid, WiFi.BSSID(),
+                       sizeof(wifi_cache.bssid));
+                wifi_cache.channel = WiFi.channel();
                 configTime(draw_param.oncloud_timezone_sec, 0, ntp_server[0],
                            ntp_server[1], ntp_server[2]);
                 std::string strbuf = "http://";
@@ -3241,6 +4528,20 @@ static void wifiTask(void*) {
                     WiFi.begin(draw_param.net_tmp_ssid.c_str(),
                                draw_param.net_tmp_pwd.c_str());
                     connecting_retry = 64;
+                } else if (wifi_cache.channel) {
+                    // 記憶したチャネルとBSSIDで接続する。失敗した場合は次回から
+                    // 通常の接続に戻す
+                    wifi_config_t conf;
+                    esp_wifi_get_config(WIFI_IF_STA, &conf);
+                    char ssid[sizeof(conf.sta.ssid) + 1]         = {0};
+                    char password[sizeof(conf.sta.password) + 1] = {0};
+                    memcpy(ssid, conf.sta.ssid, sizeof(conf.sta.ssid));
+                    memcpy(password, conf.sta.password,
+                           sizeof(conf.sta.password));
+                    WiFi.begin(ssid, password, wifi_cache.channel,
+                               wifi_cache.bssid);
+                    wifi_cache.channel = 0;
+                    connecting_retry   = 128;
                 } else {
                     WiFi.begin();
                     connecting_retry = 512;
@@ -3252,15 +4553,66 @@ static void wifiTask(void*) {
     }
 }
 
+// 間欠動作用の時計 (RTCの秒)
+struct rtc_clock_t {
+    uint32_t now(void) const {
+        return time(nullptr);
+    }
+};
+
+// 間欠動作の条件。画面を消しクラウド送信のみ行っている場合に限る
+static bool isDutyCycleActive(void) {
+    static constexpr const uint16_t min_interval_sec = 600;
+    return draw_param.cloud_dutycycle && draw_param.misc_headless &&
+           draw_param.net_running_mode ==
+               draw_param.net_running_mode_t::net_running_mode_cloud &&
+           config_param_t::cloud_interval_value[draw_param.cloud_interval] >=
+               min_interval_sec;
+}
+
+static void lightSleep(uint32_t sec) {
+    // ボタン (BtnA:GPIO37 / BtnB:GPIO39) でも起きられるようにする。
+    // 長時間でも一定間隔で起きて設定の変化を確認する
+    if (sec > 60) {
+        sec = 60;
+    }
+    // I2C の読み出し途中で眠らないよう、先にセンサの読み出しを止める。
+    // 止まらなければ今回は眠らずに次の周期で再試行する
+    if (!command_processor::suspendSensor(200)) {
+        return;
+    }
+    gpio_wakeup_enable(GPIO_NUM_37, GPIO_INTR_LOW_LEVEL);
+    gpio_wakeup_enable(GPIO_NUM_39, GPIO_INTR_LOW_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+    esp_sleep_enable_timer_wakeup((uint64_t)sec * 1000000u);
+    esp_light_sleep_start();
+    gpio_wakeup_disable(GPIO_NUM_37);
+    gpio_wakeup_disable(GPIO_NUM_39);
+    command_processor::resumeSensor();
+}
+
 static void cloudTask(void*) {
     std::string json_frame;
 
+    // 間欠動作。送信の warmup_sec 秒前に起きて積算撮影とWiFi接続を行う
+    static constexpr const uint32_t duty_warmup_sec  = 5;
+    static constexpr const uint32_t duty_timeout_sec = 30;
+    static constexpr const uint8_t duty_still_frames = 3;
+    duty_cycle_scheduler_t<rtc_clock_t> duty_scheduler;
+    bool duty_capture = false;
+    bool duty_upload  = false;
+
     static constexpr const int32_t prepare_sec = 3;
 
     delay(1024);
 
     time_t time_next_upload = 0;
     time_t time_prev_upload = time(nullptr);
+
+    // 静止したシーンでは送信を見送る。ただし生存確認のため一定回数ごとに送信する
+    static constexpr const uint8_t upload_heartbeat = 10;
+    uint32_t upload_scene_change = draw_param.scene_change_count - 1;
+    uint8_t upload_skip          = 0;
     {
         auto interval_sec =
             config_param_t::cloud_interval_value[draw_param.cloud_interval];
@@ -3274,6 +4626,86 @@ static void cloudTask(void*) {
             : draw_param.cloud_status_t::cloud_disable;
     for (;;) {
         delay(64);
+        if (isDutyCycleActive()) {
+            duty_scheduler.setup(
+                config_param_t::cloud_interval_value[draw_param.cloud_interval],
+                duty_warmup_sec, duty_timeout_sec);
+            auto status = draw_param.cloud_status;
+            if (duty_upload) {
+                // 送信中。終わるか時間切れになったら次の周期へ進める
+                bool timeout = duty_scheduler.update() ==
+                               duty_scheduler.action_timeout;
+                if (status == draw_param.cloud_status_t::cloud_complete ||
+                    timeout) {
+                    duty_upload             = false;
+                    draw_param.cloud_status = draw_param.cloud_status_t::
+                        cloud_timerwait;
+                    duty_scheduler.complete();
+                    continue;
+                }
+            } else {
+                switch (duty_scheduler.update()) {
+                    case duty_scheduler.action_sleep:
+                        draw_param.request_wifi_state &=
+                            ~draw_param_t::net_running_mode_cloud;
+                        draw_param.cloud_countdown_sec =
+                            duty_scheduler.getSlot() - time(nullptr);
+                        if (!WiFi.isConnected()) {
+                            lightSleep(duty_scheduler.getSleepSeconds());
+                        }
+                        continue;
+
+                    case duty_scheduler.action_warmup:
+                        draw_param.request_wifi_state |=
+                            draw_param_t::net_running_mode_cloud;
+                        if (!duty_capture) {
+                            duty_capture = true;
+                            if (!draw_param.still_request &&
+                                draw_param.still_state !=
+                                    draw_param.still_capturing) {
+                                draw_param.still_request = duty_still_frames;
+                            }
+                        }
+                        continue;
+
+                    case duty_scheduler.action_upload:
+                        draw_param.request_wifi_state |=
+                            draw_param_t::net_running_mode_cloud;
+                        if (draw_param.still_request ||
+                            draw_param.still_state ==
+                                draw_param.still_capturing ||
+                            !WiFi.isConnected()) {
+                            continue;
+                        }
+                        {
+                            // 積算撮影に失敗した場合は最新のフレームを送る
+                            auto src = (duty_capture &&
+                                        draw_param.still_state ==
+                                            draw_param.still_ready &&
+                                        draw_param.still_frame)
+                                           ? draw_param.still_frame
+                                           : draw_param.frame;
+                            framedata_t frame = *src;
+                            json_frame        = "{ \"payload\": ";
+                            json_frame += frame.getJsonData();
+                            json_frame += "}\r\n";
+                        }
+                        duty_capture = false;
+                        duty_upload  = true;
+                        draw_param.cloud_status =
+                            draw_param.cloud_status_t::cloud_connection;
+                        continue;
+
+                    default:
+                        duty_capture = false;
+                        duty_scheduler.complete();
+                        continue;
+                }
+            }
+        } else if (duty_upload || duty_capture) {
+            duty_upload  = false;
+            duty_capture = false;
+        }
         if (!(draw_param.net_running_mode &
               draw_param.net_running_mode_cloud)) {
             if ((bool)(draw_param.request_wifi_state &
@@ -3312,10 +4744,18 @@ static void cloudTask(void*) {
                             (0 <= time_diff) ? time_diff : 0;
 
                         if (0 > time_diff) {
-                            draw_param.cloud_status =
-                                draw_param.cloud_status_t::cloud_connection;
                             time_prev_upload =
                                 (t / interval_sec) * interval_sec;
+                            if (draw_param.sens_scenegate &&
+                                upload_scene_change ==
+                                    draw_param.scene_change_count &&
+                                ++upload_skip < upload_heartbeat) {
+                                break;
+                            }
+                            upload_skip         = 0;
+                            upload_scene_change = draw_param.scene_change_count;
+                            draw_param.cloud_status =
+                                draw_param.cloud_status_t::cloud_connection;
 #if defined(ESP_LOGD)
                             auto tm = localtime(&t);
                             ESP_LOGD(
@@ -3556,10 +4996,8 @@ void setup(void) {
     //*/
 
     command_processor::setup();
-    for (int i = 0; i < 4; ++i) {
-        draw_param.graph_data.temp_arrays[i] = (uint16_t*)malloc(
-            draw_param.graph_data.data_len * sizeof(uint16_t));
-    }
+    draw_param.graph_data.setup();
+    draw_param.frame_recorder.setup();
 
     // webサーバタスクは loopと同じ APP_CPUプライオリティ1
     // を指定、優劣をつけない
@@ -3615,8 +5053,8 @@ void setup(void) {
 
     soundStartUp();
 
-    xTaskCreatePinnedToCore(drawTask, "drawTask", 4096, nullptr, 1, nullptr,
-                            PRO_CPU_NUM);
+    xTaskCreatePinnedToCore(drawTask, "drawTask", 4096, nullptr, 1,
+                            &draw_task_handle, PRO_CPU_NUM);
 
     delay(16);
 
@@ -3696,10 +5134,561 @@ void setup(void) {
     // pinMode(GPIO_NUM_33, OUTPUT);
 }
 
+// サブページの温度データをそのままフレームに書き込む (補間処理なし)
+static void applySubpageData(framedata_t* frame,
+                             const m5::MLX90640_Class::temp_data_t* temp_data) {
+    bool subpage   = temp_data->subpage;
+    frame->subpage = subpage;
+    for (int idx = 0; idx < mlx_width * mlx_height; ++idx) {
+        uint_fast8_t y = idx >> 4;
+        uint_fast8_t x = ((mlx_width - 1 - (idx - (y << 4))) << 1) +
+                         ((y & 1) == subpage);
+        frame->pixel_raw[x + y * frame_width] = temp_data->data[idx];
+    }
+}
+
+// 監視エリアおよびユーザー定義領域の最高・最低・平均温度と中央温度を求める。
+// track : ホットスポットの追跡IDを新しく割り当てる (ライブのフレームのみ true)
+static void updateFrameStatistics(framedata_t* frame, bool track = true) {
+    static roi_engine_t roi_engine;
+    roi_engine.build(frame->pixel_raw);
+
+    uint8_t moniy =
+        draw_param.sens_monitorarea_value[draw_param.sens_monitorarea];
+    uint8_t monix = moniy >> 4;
+    moniy &= 0x0F;
+
+    roi_rect_t area = {(uint8_t)(mlx_width - monix),
+                       (uint8_t)((mlx_height >> 1) - moniy),
+                       (uint8_t)(monix << 1), (uint8_t)(moniy << 1)};
+    roi_result_t result;
+    roi_engine.query(area, &result);
+    frame->low_x                = result.low_x;
+    frame->low_y                = result.low_y;
+    frame->high_x               = result.high_x;
+    frame->high_y               = result.high_y;
+    frame->temp[frame->lowest]  = result.lowest;
+    frame->temp[frame->highest] = result.highest;
+    frame->temp[frame->average] = result.average;
+    frame->temp[frame->center] =
+        frame->pixel_raw[(frame_width >> 1) +
+                         (frame_width * (frame_height >> 1))];
+    frame->histogram.build(frame->pixel_raw, result.lowest, result.highest,
+                           monix, moniy);
+    frame->blobs.detect(frame->pixel_raw, frame->histogram, track);
+    frame->median  = frame->histogram.median();
+    frame->hotspot = frame->blobs.count ? frame->blobs.blobs[0].peak
+                                        : frame->temp[frame->highest];
+
+    for (size_t i = 0; i < roi_engine_t::roi_max; ++i) {
+        if (!roi_engine.query(draw_param.roi_rect[i], &frame->roi[i])) {
+            memset(&frame->roi[i], 0, sizeof(roi_result_t));
+        }
+    }
+}
+
+// アラームの判定はフレームごとに行う
+static void evaluateAlarm(const framedata_t* frame) {
+    static alarm_engine_t alarm_engine;
+
+    // 設定画面のアラームを先頭のルールとし、Web APIで追加したルールを続ける
+    alarm_rule_t rules[alarm_engine_t::rule_max + 1];
+    rules[0]           = {};
+    rules[0].mode      = draw_param.alarm_mode;
+    rules[0].reference = draw_param.alarm_reference;
+    rules[0].threshold = draw_param.alarm_temperature;
+    memcpy(&rules[1], draw_param.alarm_rules, sizeof(draw_param.alarm_rules));
+    alarm_engine.setRules(rules, alarm_engine_t::rule_max + 1,
+                          draw_param.roi_rect);
+
+    draw_param.alarm_active      = alarm_engine.evaluate(frame, millis());
+    draw_param.alarm_active_mask = alarm_engine.getActiveMask();
+}
+
+void alarm_engine_t::setRules(const alarm_rule_t* rules, size_t count,
+                              const roi_rect_t* rois) {
+    if (count > rule_max + 1) {
+        count = rule_max + 1;
+    }
+    if (_rule_count == count &&
+        0 == memcmp(_rules, rules, count * sizeof(alarm_rule_t)) &&
+        0 == memcmp(_rois, rois, sizeof(_rois))) {
+        return;
+    }
+    _rule_count = count;
+    memcpy(_rules, rules, count * sizeof(alarm_rule_t));
+    memcpy(_rois, rois, sizeof(_rois));
+    compile();
+}
+
+void alarm_engine_t::compile(void) {
+    static constexpr const size_t roi_offset = offsetof(framedata_t, roi);
+    auto temp_at = [](size_t idx) {
+        return offsetof(framedata_t, temp) + sizeof(uint16_t) * idx;
+    };
+
+    _entry_count = 0;
+    _active_mask = 0;
+    for (size_t i = 0; i < _rule_count; ++i) {
+        auto rule = &_rules[i];
+        if (rule->mode == config_param_t::alarm_mode_off ||
+            rule->mode >= config_param_t::alarm_mode_max) {
+            continue;
+        }
+
+        // 参照する値の framedata_t 内での位置を求める
+        size_t offset = 0;
+        if (rule->source == 0) {
+            switch (rule->reference) {
+                case config_param_t::alarm_reference_highest:
+                    offset = temp_at(framedata_t::highest);
+                    break;
+                case config_param_t::alarm_reference_lowest:
+                    offset = temp_at(framedata_t::lowest);
+                    break;
+                case config_param_t::alarm_reference_center:
+                    offset = temp_at(framedata_t::center);
+                    break;
+                case config_param_t::alarm_reference_average:
+                    offset = temp_at(framedata_t::average);
+                    break;
+                case config_param_t::alarm_reference_median:
+                    offset = offsetof(framedata_t, median);
+                    break;
+                case config_param_t::alarm_reference_hotspot:
+                    offset = offsetof(framedata_t, hotspot);
+                    break;
+                default:
+                    continue;
+            }
+        } else {
+            // ROIは最高・最低・平均のみ
+            size_t r = rule->source - 1;
+            if (r >= roi_engine_t::roi_max || !_rois[r].w || !_rois[r].h) {
+                continue;
+            }
+            offset = roi_offset + r * sizeof(roi_result_t);
+            switch (rule->reference) {
+                case config_param_t::alarm_reference_highest:
+                    offset += offsetof(roi_result_t, highest);
+                    break;
+                case config_param_t::alarm_reference_lowest:
+                    offset += offsetof(roi_result_t, lowest);
+                    break;
+                case config_param_t::alarm_reference_average:
+                    offset += offsetof(roi_result_t, average);
+                    break;
+                default:
+                    continue;
+            }
+        }
+
+        bool lower    = rule->mode == config_param_t::alarm_mode_lowtemp;
+        auto e        = &_entries[_entry_count++];
+        e->offset     = offset;
+        e->sign       = lower ? -1 : 1;
+        e->rate       = rule->rate;
+        e->index      = i;
+        e->active     = false;
+        e->duration   = rule->duration;
+        e->on_level   = e->sign * rule->threshold;
+        e->off_level  = e->on_level - rule->hysteresis;
+        e->since_msec = 0;
+        e->ref_msec   = 0;
+        e->rate_value = 0;
+    }
+}
+
+bool alarm_engine_t::evaluate(const framedata_t* frame, uint32_t msec) {
+    auto base     = (const uint8_t*)frame;
+    uint32_t mask = 0;
+    for (size_t i = 0; i < _entry_count; ++i) {
+        auto e    = &_entries[i];
+        int32_t v = *(const uint16_t*)(base + e->offset);
+        if (e->rate) {
+            // 1秒以上の間隔で変化量を更新する
+            if (e->ref_msec == 0) {
+                e->ref_value = v;
+                e->ref_msec  = msec | 1;
+            }
+            int32_t dt = msec - e->ref_msec;
+            if (dt >= 1000) {
+                e->rate_value = (v - e->ref_value) * 1000 / dt;
+                e->ref_value  = v;
+                e->ref_msec   = msec | 1;
+            }
+            v = e->rate_value;
+        }
+        v *= e->sign;
+
+        // 発報中は off_level まで戻るまで維持する
+        if (v > (e->active ? e->off_level : e->on_level)) {
+            if (e->since_msec == 0) {
+                e->since_msec = msec | 1;
+            }
+            if (!e->active && (msec - e->since_msec) >= e->duration) {
+                e->active = true;
+            }
+        } else {
+            e->since_msec = 0;
+            e->active     = false;
+        }
+        if (e->active) {
+            mask |= 1u << e->index;
+        }
+    }
+    _active_mask = mask;
+    return mask != 0;
+}
+
+void blob_list_t::detect(const uint16_t* pixel_raw,
+                         const frame_histogram_t& hist, bool track) {
+    static constexpr const size_t pixel_count    = frame_width * frame_height;
+    static constexpr const size_t label_max      = 64;
+    static constexpr const int32_t contrast_min = 128;  // 1℃
+
+    // 前回の結果は追跡IDの引き継ぎに使う
+    blob_list_t prev = *this;
+    count            = 0;
+
+    // 中央値と99%点の中間を閾値とする。温度差が小さい場合は検出しない
+    int32_t median = hist.median();
+    int32_t upper  = hist.percentile(990);
+    if (upper - median < contrast_min) {
+        return;
+    }
+    uint32_t threshold = median + ((upper - median) >> 1);
+
+    // Union-Find (根は常に連結成分内で最も若いインデクスとする)
+    static uint16_t parent[pixel_count];
+    auto find = [](uint32_t i) {
+        while (parent[i] != i) {
+            parent[i] = parent[parent[i]];
+            i         = parent[i];
+        }
+        return i;
+    };
+    for (uint32_t i = 0; i < pixel_count; ++i) {
+        parent[i] = i;
+        if (pixel_raw[i] < threshold) {
+            continue;
+        }
+        uint32_t x = i % frame_width;
+        if (x && pixel_raw[i - 1] >= threshold) {
+            parent[i] = find(i - 1);
+        }
+        if (i >= frame_width && pixel_raw[i - frame_width] >= threshold) {
+            uint32_t a = find(i);
+            uint32_t b = find(i - frame_width);
+            if (a < b) {
+                parent[b] = a;
+            } else {
+                parent[a] = b;
+            }
+        }
+    }
+
+    // 連結成分ごとに集計する
+    struct stat_t {
+        uint16_t area;
+        uint16_t peak;
+        uint16_t peak_idx;
+        uint16_t sx;
+        uint16_t sy;
+    };
+    static stat_t stats[label_max];
+    static uint8_t label[pixel_count];
+    size_t label_count = 0;
+    for (uint32_t i = 0; i < pixel_count; ++i) {
+        uint32_t raw = pixel_raw[i];
+        if (raw < threshold) {
+            continue;
+        }
+        uint32_t r = find(i);
+        if (r == i) {
+            if (label_count >= label_max) {
+                label[i] = UINT8_MAX;
+                continue;
+            }
+            label[i] = label_count;
+            memset(&stats[label_count], 0, sizeof(stat_t));
+            ++label_count;
+        }
+        uint32_t l = label[r];
+        if (l >= label_count) {
+            continue;
+        }
+        auto st = &stats[l];
+        ++st->area;
+        st->sx += i % frame_width;
+        st->sy += i / frame_width;
+        if (st->peak < raw) {
+            st->peak     = raw;
+            st->peak_idx = i;
+        }
+    }
+
+    // 1ピクセルのみの領域はノイズとして除外し、最高温度の高い順に並べる
+    for (size_t l = 0; l < label_count; ++l) {
+        auto st = &stats[l];
+        if (st->area < 2) {
+            continue;
+        }
+        size_t pos = count;
+        while (pos && blobs[pos - 1].peak < st->peak) {
+            if (pos < blob_max) {
+                blobs[pos] = blobs[pos - 1];
+            }
+            --pos;
+        }
+        if (pos >= blob_max) {
+            continue;
+        }
+        auto blob    = &blobs[pos];
+        blob->area   = st->area;
+        blob->peak   = st->peak;
+        blob->peak_x = st->peak_idx % frame_width;
+        blob->peak_y = st->peak_idx / frame_width;
+        blob->cx     = (st->sx << 4) / st->area;
+        blob->cy     = (st->sy << 4) / st->area;
+        if (count < blob_max) {
+            ++count;
+        }
+    }
+
+    // 前回の重心から3ピクセル以内で最も近い領域の追跡IDを引き継ぐ
+    static constexpr const int32_t track_dist = 3 << 4;
+    static uint8_t next_id                    = 0;
+    bool used[blob_max]                       = {false};
+    for (size_t i = 0; i < count; ++i) {
+        auto blob     = &blobs[i];
+        int32_t best  = track_dist * track_dist + 1;
+        size_t best_j = blob_max;
+        for (size_t j = 0; j < prev.count && j < blob_max; ++j) {
+            if (used[j] || prev.blobs[j].id == 0) continue;
+            int32_t dx = blob->cx - prev.blobs[j].cx;
+            int32_t dy = blob->cy - prev.blobs[j].cy;
+            int32_t d  = dx * dx + dy * dy;
+            if (best > d) {
+                best   = d;
+                best_j = j;
+            }
+        }
+        if (best_j < blob_max) {
+            used[best_j] = true;
+            blob->id     = prev.blobs[best_j].id;
+        } else if (!track) {
+            blob->id = 0;
+        } else {
+            if (++next_id == 0) {
+                next_id = 1;
+            }
+            blob->id = next_id;
+        }
+    }
+}
+
+void roi_engine_t::build(const uint16_t* pixel_raw) {
+    _pixel_raw = pixel_raw;
+
+    // 積分画像。先頭の行と列は0
+    static constexpr const size_t sum_width = frame_width + 1;
+    memset(_sum, 0, sum_width * sizeof(_sum[0]));
+    for (size_t y = 0; y < frame_height; ++y) {
+        auto src     = &pixel_raw[y * frame_width];
+        auto prev    = &_sum[y * sum_width];
+        auto dst     = &_sum[(y + 1) * sum_width];
+        uint32_t row = 0;
+        dst[0]       = 0;
+        for (size_t x = 0; x < frame_width; ++x) {
+            row += src[x];
+            dst[x + 1] = prev[x + 1] + row;
+        }
+
+        // 同値の場合は左側を優先する
+        auto mn = _min_x[0][y];
+        auto mx = _max_x[0][y];
+        for (size_t x = 0; x + 1 < frame_width; ++x) {
+            mn[x] = (src[x + 1] < src[x]) ? x + 1 : x;
+            mx[x] = (src[x + 1] > src[x]) ? x + 1 : x;
+        }
+        for (size_t level = 1; level < level_max; ++level) {
+            size_t half = 1u << level;
+            auto pmn    = _min_x[level - 1][y];
+            auto pmx    = _max_x[level - 1][y];
+            mn          = _min_x[level][y];
+            mx          = _max_x[level][y];
+            for (size_t x = 0; x + (half << 1) <= frame_width; ++x) {
+                uint8_t l = pmn[x];
+                uint8_t r = pmn[x + half];
+                mn[x]     = (src[r] < src[l]) ? r : l;
+                l         = pmx[x];
+                r         = pmx[x + half];
+                mx[x]     = (src[r] > src[l]) ? r : l;
+            }
+        }
+    }
+}
+
+bool roi_engine_t::query(const roi_rect_t& rect, roi_result_t* result) const {
+    int x0 = rect.x;
+    int y0 = rect.y;
+    int x1 = x0 + rect.w;
+    int y1 = y0 + rect.h;
+    if (x1 > frame_width) x1 = frame_width;
+    if (y1 > frame_height) y1 = frame_height;
+    if (x0 >= x1 || y0 >= y1 || _pixel_raw == nullptr) {
+        return false;
+    }
+
+    static constexpr const size_t sum_width = frame_width + 1;
+    uint32_t total = _sum[y1 * sum_width + x1] - _sum[y0 * sum_width + x1] -
+                     _sum[y1 * sum_width + x0] + _sum[y0 * sum_width + x0];
+    result->average = total / ((x1 - x0) * (y1 - y0));
+
+    // 区間を2^level幅の2つの(重なりうる)区間で覆い、各行の最低・最高を求める
+    int level        = 31 - __builtin_clz(x1 - x0);
+    int xr           = x1 - (1 << level);
+    uint32_t lowest  = UINT16_MAX + 1;
+    uint32_t highest = 0;
+    result->low_x    = x0;
+    result->low_y    = y0;
+    result->high_x   = x0;
+    result->high_y   = y0;
+    for (int y = y0; y < y1; ++y) {
+        auto src = &_pixel_raw[y * frame_width];
+        int lx   = x0;
+        int hx   = x0;
+        if (level) {
+            auto mn = _min_x[level - 1][y];
+            auto mx = _max_x[level - 1][y];
+            lx      = (src[mn[xr]] < src[mn[x0]]) ? mn[xr] : mn[x0];
+            hx      = (src[mx[xr]] > src[mx[x0]]) ? mx[xr] : mx[x0];
+        }
+        if (lowest > src[lx]) {
+            lowest        = src[lx];
+            result->low_x = lx;
+            result->low_y = y;
+        }
+        if (highest < src[hx]) {
+            highest        = src[hx];
+            result->high_x = hx;
+            result->high_y = y;
+        }
+    }
+    result->lowest  = lowest;
+    result->highest = highest;
+    return true;
+}
+
+void frame_histogram_t::build(const uint16_t* pixel_raw, uint16_t lowest,
+                              uint16_t highest, uint8_t monix,
+                              uint8_t moniy) {
+    // 最低～最高温度が bin_count 個に収まる最小のビン幅を選ぶ
+    uint_fast8_t s = 0;
+    while (((highest - lowest) >> s) >= bin_count) {
+        ++s;
+    }
+    base  = lowest;
+    shift = s;
+    memset(bins, 0, sizeof(bins));
+    uint32_t count = 0;
+    for (uint_fast8_t y = (mlx_height >> 1) - moniy;
+         y < (mlx_height >> 1) + moniy; ++y) {
+        auto src = &pixel_raw[y * frame_width];
+        for (uint_fast8_t x = mlx_width - monix; x < mlx_width + monix; ++x) {
+            ++bins[(src[x] - lowest) >> s];
+            ++count;
+        }
+    }
+    total = count;
+}
+
+uint16_t frame_histogram_t::percentile(uint32_t permille) const {
+    uint32_t rank = (total * permille) / 1000;
+    if (rank >= total) {
+        rank = total - 1;
+    }
+    uint32_t cum = 0;
+    for (size_t i = 0; i < bin_count; ++i) {
+        uint32_t n = bins[i];
+        if (cum + n > rank) {
+            // ビン内は均等に分布しているものとして補間する
+            uint32_t frac = (((rank - cum) * 2 + 1) << shift) / (n * 2);
+            return base + (i << shift) + frac;
+        }
+        cum += n;
+    }
+    return base;
+}
+
+// 省電力制御。シーンの変化・ボタン操作・配信・アラームのない状態が続いたら
+// センサの更新レートを下げ、計測した処理時間が予算内に収まる最低のクロックを選ぶ
+static void updatePowerGovernor(uint32_t msec) {
+    static constexpr const uint32_t idle_msec   = 10000;
+    static constexpr const uint32_t busy_budget = 600000;  // 1秒あたり (usec)
+    static constexpr const auto idle_refreshrate =
+        config_param_t::sens_refreshrate_2;
+    static uint32_t prev_scene_change = 0;
+    static uint8_t prev_input         = 0;
+    static uint32_t active_msec       = 0;
+    static uint32_t check_msec        = 0;
+
+    if (!draw_param.misc_governor || draw_param.alarm_active ||
+        draw_param.in_config_mode || screenshot_holder.isPending() ||
+        prev_scene_change != draw_param.scene_change_count ||
+        prev_input != draw_param.input_count) {
+        prev_scene_change = draw_param.scene_change_count;
+        prev_input        = draw_param.input_count;
+        active_msec       = msec;
+    }
+    bool idle = (msec - active_msec) >= idle_msec;
+    if (idle == draw_param.power_idle && (msec - check_msec) < 1000) {
+        return;
+    }
+    check_msec            = msec;
+    draw_param.power_idle = idle;
+
+    auto rate = draw_param.sens_refreshrate.get_enum();
+    if (idle && rate > idle_refreshrate) {
+        rate = idle_refreshrate;
+    }
+    command_processor::setRate(draw_param.sens_refreshrate_value[rate]);
+
+    rtc_cpu_freq_config_t conf;
+    rtc_clk_cpu_freq_get_config(&conf);
+    uint32_t mhz = conf.freq_mhz;
+    auto speed   = draw_param.misc_cpuspeed.get_enum();
+    if (idle) {
+        // 処理時間はクロックに反比例するとみなし、各コアの使用時間が予算内に
+        // 収まる最低のクロックを選ぶ
+        auto meter    = draw_param.busy_meter;
+        uint32_t app  = meter[draw_param.busy_frame].usec;
+        uint32_t pro  = meter[draw_param.busy_ui].usec +
+                       meter[draw_param.busy_render].usec;
+        uint32_t busy = (app > pro) ? app : pro;
+        for (int i = 0; i < speed; ++i) {
+            if (busy * mhz <= busy_budget * draw_param.misc_cpuspeed_value[i]) {
+                speed = (config_param_t::misc_cpuspeed_t)i;
+                break;
+            }
+        }
+        // 160MHz と 240MHz をまたぐ変更は WiFi の再接続を伴うため、
+        // WiFi 使用中は現在のクロックを維持する
+        if (WiFi.getMode() != WIFI_OFF &&
+            (mhz > 160) != (draw_param.misc_cpuspeed_value[speed] > 160)) {
+            return;
+        }
+    }
+    if (draw_param.misc_cpuspeed_value[speed] != mhz) {
+        config_param_t::misc_cpuspeed_func(speed);
+    }
+}
+
 void loop(void) {
     if (config_save_countdown) {
         auto br = draw_param.misc_brightness_value[draw_param.misc_brightness];
-        if (display.getBrightness() != br) {
+        if (!draw_param.misc_headless && display.getBrightness() != br) {
             display.setBrightness(br);
         }
         if (0 == --config_save_countdown) {
@@ -3746,27 +5735,12 @@ void loop(void) {
         }
     }
 
+    updatePowerGovernor(msec);
+
     static uint32_t _alarm_last_time = 0;
     static uint32_t _alarm_interval  = 500;
-    // 温度アラーム判定
+    // 温度アラームの報知 (判定はフレーム処理時に evaluateAlarm で行う)
     if (((msec - _alarm_last_time) > _alarm_interval)) {
-        auto frame   = &framedata[idx_recv];
-        int temp_idx = 0;
-        switch (draw_param.alarm_reference) {
-            case draw_param_t::alarm_reference_highest:
-                temp_idx = frame->highest;
-                break;
-            case draw_param_t::alarm_reference_lowest:
-                temp_idx = frame->lowest;
-                break;
-            case draw_param_t::alarm_reference_center:
-                temp_idx = frame->center;
-                break;
-            case draw_param_t::alarm_reference_average:
-                temp_idx = frame->average;
-                break;
-        }
-
         enum alarm_state_t {
             alarm_none,
             alarm_on1,
@@ -3781,16 +5755,7 @@ void loop(void) {
         } else {
             _alarm_last_time += _alarm_interval;
         }
-        int temp   = (frame->temp[temp_idx]);
-        bool alarm = false;
-        switch (draw_param.alarm_mode) {
-            case draw_param_t::alarm_mode_t::alarm_mode_hightemp:
-                alarm = temp > draw_param.alarm_temperature;
-                break;
-            case draw_param_t::alarm_mode_t::alarm_mode_lowtemp:
-                alarm = temp < draw_param.alarm_temperature;
-                break;
-        }
+        bool alarm                = draw_param.alarm_active;
         alarm_state_t alarm_state = alarm_none;
         if (alarm) {
             alarm_state =
@@ -3809,19 +5774,17 @@ void loop(void) {
             bool buzzer = false;
             bool led    = false;
 
-            if (draw_param.alarm_mode) {
-                switch (alarm_state) {
-                    default:
-                        break;
+            switch (alarm_state) {
+                default:
+                    break;
 
-                    case alarm_state_t::alarm_on1:
-                        buzzer = true;
-                        break;
+                case alarm_state_t::alarm_on1:
+                    buzzer = true;
+                    break;
 
-                    case alarm_state_t::alarm_on2:
-                        led = true;
-                        break;
-                }
+                case alarm_state_t::alarm_on2:
+                    led = true;
+                    break;
             }
 
             // switch (draw_param.alarm_behavior) {
@@ -3867,6 +5830,12 @@ void loop(void) {
     //*/
 
     M5.update();
+    if (M5.BtnA.wasChangePressed() || M5.BtnB.wasChangePressed() ||
+        M5.BtnC.wasChangePressed() || M5.BtnPWR.wasClicked() ||
+        M5.BtnPWR.wasHold()) {
+        ++draw_param.input_count;
+        notifyDrawTask();
+    }
     /*
         if (M5.BtnPWR.wasClicked()) {
             confmode = !confmode;
@@ -3878,7 +5847,19 @@ void loop(void) {
         }
     //*/
 
-    if (draw_param.in_config_mode) {
+    if (draw_param.misc_headless) {
+        // 無表示モード中はボタン操作で表示を再開し、操作自体は UI に渡さない
+        if (draw_param.in_config_mode) {
+            changeLayout_Normal(false);
+        }
+        if (M5.BtnA.wasClicked() || M5.BtnB.wasClicked() ||
+            M5.BtnC.wasClicked() || M5.BtnPWR.wasClicked() ||
+            M5.BtnA.wasHold() || M5.BtnB.wasHold() || M5.BtnC.wasHold() ||
+            M5.BtnPWR.wasHold()) {
+            soundOperate();
+            draw_param.misc_headless = draw_param.misc_headless_off;
+        }
+    } else if (draw_param.in_config_mode) {
         if (!config_ui.loop() || M5.BtnPWR.wasHold() || M5.BtnC.wasHold()) {
             changeLayout_Normal(false);
         }
@@ -3953,10 +5934,50 @@ void loop(void) {
         //*/
     }
 
+    command_processor::setHold(draw_param.in_pause_state);
+
     // 温度センサからデータ取得
-    if (!command_processor::loop()) {
+    bool recv = command_processor::loop();
+
+    // 放射率・反射温度が変更された場合は再計算された温度でフレームを作り直す
+    if (command_processor::takeRecalcDone() && idx_recv >= 0) {
+        int idx_recv_next = (idx_recv + 1) % framedata_len;
+        auto frame        = &framedata[idx_recv_next];
+        memcpy(frame, &framedata[idx_recv], sizeof(framedata_t));
+        // 古いサブページから順に反映する
+        for (int i = 1; i >= 0; --i) {
+            applySubpageData(frame, command_processor::getTemperatureData(i));
+        }
+        updateFrameStatistics(frame, false);
+        evaluateAlarm(frame);
+        ++draw_param.scene_change_count;
+        idx_recv = idx_recv_next;
+        notifyDrawTask();
+    }
+
+    // 静止画撮影
+    // 状態を書いてから要求を消すため、要求側からは常に撮影中に見える
+    uint8_t still_frames = draw_param.still_request;
+    if (still_frames) {
+        draw_param.still_state =
+            command_processor::requestStillCapture(still_frames)
+                ? draw_param.still_capturing
+                : draw_param.still_error;
+        draw_param.still_request = 0;
+    }
+    if (command_processor::takeStillCaptureDone()) {
+        static framedata_t still_frame;
+        applySubpageData(&still_frame, command_processor::getStillData(0));
+        applySubpageData(&still_frame, command_processor::getStillData(1));
+        updateFrameStatistics(&still_frame, false);
+        draw_param.still_frame = &still_frame;
+        draw_param.still_state = draw_param.still_ready;
+    }
+
+    if (!recv) {
         delay(8);
     } else if (!draw_param.in_pause_state) {
+        uint32_t usec     = micros();
         int idx_recv_next = (idx_recv + 1) % framedata_len;
         auto frame        = &framedata[idx_recv_next];
         auto prev_frame   = &framedata[idx_recv % framedata_len];
@@ -3964,158 +5985,130 @@ void loop(void) {
         // Obtain temperature data structure.
         auto temp_data = command_processor::getTemperatureData();
 
-        uint32_t search_lowest  = UINT16_MAX;
-        uint32_t search_highest = 0;
-        // search_lowest = convertCelsiusToRaw(-80);
-        // search_highest = convertCelsiusToRaw(100);
-
-        uint32_t search_total = 0;
-        uint32_t search_count = 0;
-
-        uint16_t diff[mlx_width * mlx_height];
         // Pixel data is held in an array. Array size is 384. (16x24)
         bool subpage   = temp_data->subpage;
         frame->subpage = subpage;
 
-        uint8_t moniy =
-            draw_param.sens_monitorarea_value[draw_param.sens_monitorarea];
-        uint8_t monix = moniy >> 4;
-        moniy &= 0x0F;
-
-        for (int idx = 0; idx < mlx_width * mlx_height; ++idx) {
-            // // XとYの入れ替えと上下・左右の反転を行う
-            // uint_fast8_t x = frame_width - (1 + (idx >> 4));
-            // uint_fast8_t y =
-            //     frame_height - (1 + (((idx & 15) << 1) + ((x & 1) ==
-            //     subpage)));
-            uint_fast8_t y = idx >> 4;
-            uint_fast8_t x = ((mlx_width - 1 - (idx - (y << 4))) << 1) +
-                             ((y & 1) == subpage);
-            uint_fast16_t xy     = x + y * frame_width;
-            int32_t raw          = temp_data->data[idx];
-            int d                = raw - (int32_t)frame->pixel_raw[xy];
-            diff[xy >> 1]        = abs(d);
-            frame->pixel_raw[xy] = raw;
-
-            // if (x && y && x < (frame_width - 1) && y < (frame_height - 1)) {
-            if (((moniy + y - (mlx_height >> 1)) < (moniy << 1)) &&
-                ((monix + x - (mlx_width)) <
-                 (monix
-                  << 1))) {  // 最高・最低温度の更新。最外周ピクセルは極端な外れ値を出すことがあるため除外する。
-                search_total += raw;
-                ++search_count;
-                if (search_lowest > raw) {
-                    search_lowest = raw;
-                    frame->low_x  = x;
-                    frame->low_y  = y;
-                }
-                if (search_highest < raw) {
-                    search_highest = raw;
-                    frame->high_x  = x;
-                    frame->high_y  = y;
-                }
-            }
+        // 新しいサブページの温度と前回からの変化量を外周1ピクセル分の余白付きで
+        // 保持する。余白は常に0のため、端のピクセルでも近傍4点を分岐なしで
+        // 合算できる。(旧サブページ側の位置は読まれないため更新不要)
+        static constexpr const int pad_width = frame_width + 2;
+        static uint16_t pad_raw[pad_width * (frame_height + 2)];
+        static uint16_t pad_diff[pad_width * (frame_height + 2)];
+        // 近傍数(2~4)での割り算を乗算とシフトで行うための逆数テーブル
+        static constexpr const uint32_t recip_table[] = {
+            0, 0, 1u << 31, 0x55555556u, 1u << 30};
+
+        // 背景温度 (ピクセルごとの低速な指数移動平均。raw値の16倍で保持)
+        // 背景または前回値から閾値以上離れたピクセル数をフレームの変化量とする
+        static int32_t background[frame_width * frame_height];
+        // ピクセルごとのノイズ推定値 (前回値との差の絶対値の指数移動平均。
+        // raw値の16倍で保持)。閾値はこの値に感度設定の倍率を掛けて求める
+        static uint16_t noise[frame_width * frame_height];
+        static constexpr const int32_t noise_initial        = 24 << 4;  // 0.19℃
+        static constexpr const int32_t change_threshold_min = 32;       // 0.25℃
+
+        int sens               = draw_param.sens_scenesens;
+        int32_t noise_gain     = draw_param.sens_scenesens_gain[sens];
+        uint32_t change_pixels = draw_param.sens_scenesens_pixels[sens];
+        uint32_t change_score  = 0;
+
+        // 背景の時定数が更新レートによらず約1秒になるよう、
+        // サブページの到着間隔から移動平均の重み(シフト量)を決める
+        static uint32_t prev_subpage_msec = 0;
+        uint32_t subpage_msec   = millis();
+        uint32_t subpage_period = subpage_msec - prev_subpage_msec;
+        prev_subpage_msec       = subpage_msec;
+        int bg_shift            = 1;
+        while (bg_shift < 7 && (subpage_period << bg_shift) < 1000) {
+            ++bg_shift;
         }
-        // Interpolation is performed from surrounding pixels where the
-        // temperature change is large. (Areas with little temperature change
-        // inherit values from the previous frame.)
-        for (int idx = 0; idx < 384; ++idx) {
-            // uint_fast8_t x = frame_width - (1 + (idx >> 4));
-            // uint_fast8_t y =
-            //     frame_height - (1 + (((idx & 15) << 1) + ((x & 1) !=
-            //     subpage)));
-            uint_fast8_t y = idx >> 4;
-            uint_fast8_t x = ((mlx_width - 1 - (idx - (y << 4))) << 1) +
-                             ((y & 1) != subpage);
-            uint_fast16_t xy = x + y * frame_width;
-
-            uint32_t diff_sum = 0;
-            size_t count      = 0;
-            if (x > 0) {
-                ++count;
-                diff_sum += diff[(xy - 1) >> 1];
-            }
-            if (x < (frame_width - 1)) {
-                ++count;
-                diff_sum += diff[(xy + 1) >> 1];
-            }
-            if (y > 0) {
-                ++count;
-                diff_sum += diff[(xy - frame_width) >> 1];
-            }
-            if (y < (frame_height - 1)) {
-                ++count;
-                diff_sum += diff[(xy + frame_width) >> 1];
-            }
-            diff_sum /= count;
-
-            int32_t raw = frame->pixel_raw[xy];
-
-            uint32_t sum = 0;
-            if (x > 0) {
-                sum += frame->pixel_raw[xy - 1];
-            }
-            if (x < (frame_width - 1)) {
-                sum += frame->pixel_raw[xy + 1];
-            }
-            if (y > 0) {
-                sum += frame->pixel_raw[xy - frame_width];
-            }
-            if (y < (frame_height - 1)) {
-                sum += frame->pixel_raw[xy + frame_width];
-            }
-            raw = (sum + (count >> 1)) / count;
-
-            // 温度変化量が小さい箇所は前回値の継承効果を高くする。
-            // 温度変化量が大きい箇所は補間処理効果を高くする。
-            if (diff_sum > 256) {
-                diff_sum = 256;
-            }
-            raw =
-                (frame->pixel_raw[xy] * (256 - diff_sum) + diff_sum * raw) >> 8;
-            frame->pixel_raw[xy] = raw;
-
-            // 最高・最低温度の更新。最外周ピクセルは極端な外れ値を出すことがあるため除外する。
-            if (((moniy + y - (mlx_height >> 1)) < (moniy << 1)) &&
-                ((monix + x - (mlx_width)) <
-                 (monix
-                  << 1))) {  // 最高・最低温度の更新。最外周ピクセルは極端な外れ値を出すことがあるため除外する。
-                search_total += raw;
-                ++search_count;
-                if (search_lowest > raw) {
-                    search_lowest = raw;
-                    frame->low_x  = x;
-                    frame->low_y  = y;
+
+        // 新しいサブページの行を書き込みながら、1行遅れで旧サブページ側の行を
+        // 近傍から補間する。旧サブページの近傍4点は全て新しいサブページ側の
+        // ピクセルなので、1行先まで書き込まれていれば参照できる。
+        for (int y = 0; y <= frame_height; ++y) {
+            if (y < frame_height) {
+                auto src = &temp_data->data[y * mlx_width];
+                // XとYの入れ替えと上下・左右の反転を行う
+                int x    = ((mlx_width - 1) << 1) + ((y & 1) == subpage);
+                auto dst = &frame->pixel_raw[x + y * frame_width];
+                auto bg  = &background[x + y * frame_width];
+                auto nz  = &noise[x + y * frame_width];
+                auto pad = (y + 1) * pad_width + x + 1;
+                for (int i = 0; i < mlx_width;
+                     ++i, dst -= 2, bg -= 2, nz -= 2, pad -= 2) {
+                    int32_t raw   = src[i];
+                    int32_t d     = abs(raw - (int32_t)dst[0]);
+                    pad_diff[pad] = d;
+                    pad_raw[pad]  = raw;
+                    dst[0]        = raw;
+
+                    int32_t b = 0;
+                    if (bg[0]) {
+                        b = (raw << 4) - bg[0];
+                        bg[0] += b >> bg_shift;
+                    } else {
+                        bg[0] = raw << 4;
+                        nz[0] = noise_initial;
+                    }
+                    int32_t th = (nz[0] * noise_gain) >> 4;
+                    if (th < change_threshold_min) {
+                        th = change_threshold_min;
+                    }
+                    // 実際の変化でノイズ推定値が膨らまないよう閾値で頭打ちにする
+                    int32_t n = (d < th) ? d : th;
+                    nz[0] += ((n << 4) - nz[0]) >> 5;
+                    change_score += (d > th) || (abs(b) > (th << 4));
                 }
-                if (search_highest < raw) {
-                    search_highest = raw;
-                    frame->high_x  = x;
-                    frame->high_y  = y;
+            }
+            if (y == 0) {
+                continue;
+            }
+
+            // Interpolation is performed from surrounding pixels where the
+            // temperature change is large. (Areas with little temperature
+            // change inherit values from the previous frame.)
+            int sy   = y - 1;
+            int x    = ((sy & 1) != subpage);
+            auto dst = &frame->pixel_raw[x + sy * frame_width];
+            auto pad = y * pad_width + x + 1;
+            int edge = (sy == 0) + (sy == frame_height - 1);
+            for (; x < frame_width; x += 2, dst += 2, pad += 2) {
+                uint32_t count = 4 - edge - (x == 0) - (x == frame_width - 1);
+                uint64_t recip = recip_table[count];
+                uint32_t diff_sum = pad_diff[pad - 1] + pad_diff[pad + 1] +
+                                    pad_diff[pad - pad_width] +
+                                    pad_diff[pad + pad_width];
+                uint32_t sum = pad_raw[pad - 1] + pad_raw[pad + 1] +
+                               pad_raw[pad - pad_width] +
+                               pad_raw[pad + pad_width];
+                diff_sum    = (diff_sum * recip) >> 32;
+                int32_t raw = ((sum + (count >> 1)) * recip) >> 32;
+
+                // 温度変化量が小さい箇所は前回値の継承効果を高くする。
+                // 温度変化量が大きい箇所は補間処理効果を高くする。
+                if (diff_sum > 256) {
+                    diff_sum = 256;
                 }
+                dst[0] = (dst[0] * (256 - diff_sum) + diff_sum * raw) >> 8;
             }
         }
-        //  if ( abs((int32_t)(frame->temp[frame->lowest]  - search_lowest )) >
-        //  1*128
-        //  ||  abs((int32_t)(frame->temp[frame->highest] - search_highest)) >
-        //  1*128) {
-        //     draw_param.in_pause_state = 1;
-        //  }
 
-        frame->temp[frame->lowest]  = search_lowest;
-        frame->temp[frame->highest] = search_highest;
-        frame->temp[frame->average] = search_total / search_count;
-        frame->temp[frame->center] =
-            frame->pixel_raw[(frame_width >> 1) +
-                             (frame_width * (frame_height >> 1))];
-
-        uint8_t idx = draw_param.graph_data.current_idx + 1;
-        for (uint_fast8_t i = 0; i < 4; ++i) {
-            draw_param.graph_data.temp_arrays[i][idx] = frame->temp[i];
-            // draw_param.graph_data.temp_arrays[i][idx] =
-            // graph_filter[i].exec(frame->temp[i]);
+        updateFrameStatistics(frame);
+        evaluateAlarm(frame);
+        frame->change_score = change_score;
+        if (change_score >= change_pixels) {
+            ++draw_param.scene_change_count;
         }
-        draw_param.graph_data.current_idx = idx;
-        idx_recv                          = idx_recv_next;
+
+        draw_param.graph_data.push(frame->temp, millis());
+        draw_param.frame_recorder.record(frame->pixel_raw, millis(),
+                                         draw_param.alarm_active);
+        idx_recv = idx_recv_next;
+        notifyDrawTask();
+        draw_param.busy_meter[draw_param.busy_frame].add(micros() - usec,
+                                                         millis());
     }
 }
 
@@ -4151,10 +6144,27 @@ std::string framedata_t::getJsonData(void) const {
                                  convertRawToCelsius(temp[center])));
     result.append(cbuf, snprintf(cbuf, sizeof(cbuf), " \"average\": %3.1f,\r\n",
                                  convertRawToCelsius(temp[average])));
+    result.append(cbuf, snprintf(cbuf, sizeof(cbuf), " \"median\": %3.1f,\r\n",
+                                 convertRawToCelsius(histogram.median())));
     result.append(cbuf, snprintf(cbuf, sizeof(cbuf), " \"highest\": %3.1f,\r\n",
                                  convertRawToCelsius(temp[highest])));
     result.append(cbuf, snprintf(cbuf, sizeof(cbuf), " \"lowest\": %3.1f,\r\n",
                                  convertRawToCelsius(temp[lowest])));
+    result.append(cbuf, snprintf(cbuf, sizeof(cbuf),
+                                 " \"change_score\": %d,\r\n", change_score));
+    result += " \"blobs\": [";
+    for (size_t i = 0; i < blobs.count; ++i) {
+        auto blob = &blobs.blobs[i];
+        result.append(
+            cbuf, snprintf(cbuf, sizeof(cbuf),
+                           "%s{\"id\": %d, \"area\": %d, \"peak\": %3.1f, ",
+                           i ? ", " : "", blob->id, blob->area,
+                           convertRawToCelsius(blob->peak)));
+        result.append(cbuf, snprintf(cbuf, sizeof(cbuf),
+                                     "\"x\": %.2f, \"y\": %.2f}",
+                                     blob->cx / 16.0f, blob->cy / 16.0f));
+    }
+    result += "],\r\n";
     result.append(cbuf, snprintf(cbuf, sizeof(cbuf), " \"frame\": [%3.1f",
                                  convertRawToCelsius(pixel_raw[0])));
     for (uint_fast16_t i = 1; i < frame_width * frame_height; ++i) {
@@ -65,6 +65,11 @@ struct MLX90640_params_t {
     uint16_t brokenPixels[5];
     uint16_t outlierPixels[5];
 
+    // To計算の高速化用 (２回目の評価を省略できる温度帯)
+    float fastTaTr  = 0;
+    float fastLower = 0;
+    float fastUpper = 0;
+
     static int CheckAdjacentPixels(uint16_t pix1, uint16_t pix2) {
         int pixPosDif = pix1 - pix2;
         if (pixPosDif > -34 && pixPosDif < -30) {
@@ -889,35 +894,16 @@ struct MLX90640_params_t {
         }
     }
 
-    void MLX90640_CalculateTo(const uint16_t *frameData, float emissivity,
-                              float tr, uint16_t *result) {
+    // 放射率で割る前の補正済み赤外信号を算出する
+    void MLX90640_CalculateIR(const uint16_t *frameData, float ta,
+                              float *result) const {
         float irDataCP[2];
-        float alphaCorrR[4];
-        int8_t range;
         bool subPage = frameData[833];
 
         float vdd_minus_33 = MLX90640_GetVdd(frameData) - 3.3;
-        float ta           = MLX90640_GetTa(frameData);
-
-        float ta4 = (ta + 273.15f);
-        ta4 *= ta4;
-        ta4 *= ta4;
-
-        float tr4 = (tr + 273.15f);
-        tr4 *= tr4;
-        tr4 *= tr4;
 
-        float taTr = tr4 - (tr4 - ta4) / emissivity;
-
-        float ktaScale   = pow(2, (double)this->ktaScale);
-        float kvScale    = pow(2, (double)this->kvScale);
-        float alphaScale = pow(2, (double)this->alphaScale);
-
-        alphaCorrR[0] = 1 / (1 + this->ksTo[0] * 40);
-        alphaCorrR[1] = 1;
-        alphaCorrR[2] = (1 + this->ksTo[1] * this->ct[2]);
-        alphaCorrR[3] =
-            alphaCorrR[2] * (1 + this->ksTo[2] * (this->ct[3] - this->ct[2]));
+        float ktaScale = pow(2, (double)this->ktaScale);
+        float kvScale  = pow(2, (double)this->kvScale);
 
         //------------------------- Gain calculation
         //-----------------------------------
@@ -927,7 +913,7 @@ struct MLX90640_params_t {
         }
         gain = this->gainEE / gain;
 
-        //------------------------- To calculation
+        //------------------------- IR data calculation
         //-------------------------------------
         uint8_t mode = (frameData[832] & 0x1000) >> 5;
 
@@ -950,84 +936,157 @@ struct MLX90640_params_t {
                            (1 + this->cpKv * vdd_minus_33);
         }
 
-        float ksTo127315 = 1 - this->ksTo[1] * 273.15f;
-
         for (int i = 0; i < 384; ++i) {
             int ilPattern   = (i >> 4) & 1;
             int pixelNumber = (i << 1) + ((ilPattern ^ subPage) & 1);
 
-            {
-                int conversionPattern =
-                    (((pixelNumber + 2) >> 2) - ((pixelNumber + 3) >> 2) +
-                     ((pixelNumber + 1) >> 2) - (pixelNumber >> 2)) *
-                    (1 - 2 * ilPattern);
+            int conversionPattern =
+                (((pixelNumber + 2) >> 2) - ((pixelNumber + 3) >> 2) +
+                 ((pixelNumber + 1) >> 2) - (pixelNumber >> 2)) *
+                (1 - 2 * ilPattern);
 
-                int tmp = frameData[pixelNumber];
+            int tmp = frameData[pixelNumber];
 #if defined(DEBUG_BROKENPIXEL)
-                if (pixelNumber == DEBUG_BROKENPIXEL) {
-                    tmp = 0x7FFF;
-                }
+            if (pixelNumber == DEBUG_BROKENPIXEL) {
+                tmp = 0x7FFF;
+            }
 #endif
-                if (tmp > 32767) {
-                    tmp -= 65536;
-                }
-                float irData = gain * tmp;
+            if (tmp > 32767) {
+                tmp -= 65536;
+            }
+            float irData = gain * tmp;
 
-                float kta = this->kta[pixelNumber] / ktaScale;
-                float kv  = this->kv[pixelNumber] / kvScale;
-                irData    = irData - this->offset[pixelNumber] *
-                                      (1 + kta * (ta - 25)) *
-                                      (1 + kv * vdd_minus_33);
+            float kta = this->kta[pixelNumber] / ktaScale;
+            float kv  = this->kv[pixelNumber] / kvScale;
+            irData    = irData - this->offset[pixelNumber] *
+                                  (1 + kta * (ta - 25)) *
+                                  (1 + kv * vdd_minus_33);
 
-                if (mode != this->calibrationModeEE) {
-                    irData = irData + this->ilChessC[2] * (2 * ilPattern - 1) -
-                             this->ilChessC[1] * conversionPattern;
-                }
+            if (mode != this->calibrationModeEE) {
+                irData = irData + this->ilChessC[2] * (2 * ilPattern - 1) -
+                         this->ilChessC[1] * conversionPattern;
+            }
 
-                irData = irData - this->tgc * irDataCP[subPage];
-                irData = irData / emissivity;
+            result[i] = irData - this->tgc * irDataCP[subPage];
+        }
+    }
 
-                float alphaCompensated =
-                    SCALEALPHA * alphaScale / this->alpha[pixelNumber];
-                alphaCompensated =
-                    alphaCompensated * (1 + this->KsTa * (ta - 25));
+    // 温度 t の画素について、レンジ1の２回目の評価による変化量を求める
+    float calcFastPathError(float t, float taTr) const {
+        float k   = this->ksTo[1];
+        float tk4 = t + 273.15f;
+        tk4 *= tk4;
+        tk4 *= tk4;
+        float sx = (tk4 - taTr) * (1 + k * t);
+        float tu = sqrtf(sqrtf(sx + taTr)) - 273.15f;
+        float t1 = sqrtf(sqrtf(sx / (1 + k * tu) + taTr)) - 273.15f;
+        float t2 = sqrtf(sqrtf(sx / (1 + k * t1) + taTr)) - 273.15f;
+        return fabsf(t2 - t1);
+    }
 
-                float Sx = alphaCompensated * alphaCompensated *
-                           alphaCompensated *
-                           (irData + alphaCompensated * taTr);
-                // Sx = fast_sqrt2(Sx) * this->ksTo[1];
-                // float To = fast_sqrt2(irData / (alphaCompensated *
-                // (ksTo127315) + Sx) + taTr) - 273.15f;
-                Sx       = sqrtf(sqrtf(Sx)) * this->ksTo[1];
-                float To = sqrtf(sqrtf(
-                               irData / (alphaCompensated * (ksTo127315) + Sx) +
-                               taTr)) -
-                           273.15f;
+    // ２回目の評価を省略しても誤差が 1/4 LSB 以内に収まるレンジ1の温度帯を求める
+    // (背景放射 taTr に近い温度ほど補正量が小さい)
+    void updateFastPathRange(float taTr) {
+        if (fabsf(taTr - fastTaTr) < taTr * 0.001f) return;
+        fastTaTr = taTr;
 
-                if (To < this->ct[1]) {
-                    range = 0;
-                } else if (To < this->ct[2]) {
-                    range = 1;
-                } else if (To < this->ct[3]) {
-                    range = 2;
-                } else {
-                    range = 3;
-                }
-                auto temp = (int32_t)roundf(
-                    (sqrtf(
-                         sqrtf(irData / (alphaCompensated * alphaCorrR[range] *
-                                         (1 + this->ksTo[range] *
-                                                  (To - this->ct[range]))) +
-                               taTr)) +
-                     ((float)m5::MLX90640_Class::DATA_OFFSET - 273.15f)) *
-                    m5::MLX90640_Class::DATA_RATIO_VALUE);
-                if (temp < 0) {
-                    temp = 0;
-                } else if (temp > UINT16_MAX) {
-                    temp = UINT16_MAX;
-                }
-                result[i] = temp;
+        static constexpr float tolerance =
+            0.25f / m5::MLX90640_Class::DATA_RATIO_VALUE;
+        float center = sqrtf(sqrtf(taTr)) - 273.15f;
+        if (center < this->ct[1]) {
+            center = this->ct[1];
+        }
+        fastLower = center;
+        fastUpper = center;
+        if (center >= this->ct[2] ||
+            calcFastPathError(center, taTr) > tolerance) {
+            return;
+        }
+        while (fastUpper + 1 < this->ct[2] &&
+               calcFastPathError(fastUpper + 1, taTr) <= tolerance) {
+            fastUpper += 1;
+        }
+        while (fastLower - 1 >= this->ct[1] &&
+               calcFastPathError(fastLower - 1, taTr) <= tolerance) {
+            fastLower -= 1;
+        }
+    }
+
+    // 補正済み赤外信号から温度を算出する
+    void MLX90640_CalculateTo(const float *irResult, bool subPage, float ta,
+                              float emissivity, float tr, uint16_t *result) {
+        float alphaCorrR[4];
+        float rangeA[4];
+        float rangeB[4];
+        float ct[4];
+
+        float ta4 = (ta + 273.15f);
+        ta4 *= ta4;
+        ta4 *= ta4;
+
+        float tr4 = (tr + 273.15f);
+        tr4 *= tr4;
+        tr4 *= tr4;
+
+        float taTr = tr4 - (tr4 - ta4) / emissivity;
+
+        float alphaScale = pow(2, (double)this->alphaScale);
+
+        alphaCorrR[0] = 1 / (1 + this->ksTo[0] * 40);
+        alphaCorrR[1] = 1;
+        alphaCorrR[2] = (1 + this->ksTo[1] * this->ct[2]);
+        alphaCorrR[3] =
+            alphaCorrR[2] * (1 + this->ksTo[2] * (this->ct[3] - this->ct[2]));
+
+        // alphaCorrR * (1 + ksTo * (To - ct)) = rangeA + rangeB * To
+        for (int r = 0; r < 4; ++r) {
+            ct[r]     = this->ct[r];
+            rangeA[r] = alphaCorrR[r] * (1 - this->ksTo[r] * this->ct[r]);
+            rangeB[r] = alphaCorrR[r] * this->ksTo[r];
+        }
+        updateFastPathRange(taTr);
+
+        //------------------------- To calculation
+        //-------------------------------------
+        float ksTo127315 = 1 - this->ksTo[1] * 273.15f;
+
+        for (int i = 0; i < 384; ++i) {
+            int ilPattern   = (i >> 4) & 1;
+            int pixelNumber = (i << 1) + ((ilPattern ^ subPage) & 1);
+
+            float irData = irResult[i] / emissivity;
+
+            float alphaCompensated =
+                SCALEALPHA * alphaScale / this->alpha[pixelNumber];
+            alphaCompensated = alphaCompensated * (1 + this->KsTa * (ta - 25));
+
+            float Sx = alphaCompensated * alphaCompensated * alphaCompensated *
+                       (irData + alphaCompensated * taTr);
+            // Sx = fast_sqrt2(Sx) * this->ksTo[1];
+            // float To = fast_sqrt2(irData / (alphaCompensated *
+            // (ksTo127315) + Sx) + taTr) - 273.15f;
+            Sx        = sqrtf(sqrtf(Sx)) * this->ksTo[1];
+            float toK = sqrtf(
+                sqrtf(irData / (alphaCompensated * (ksTo127315) + Sx) + taTr));
+            float To = toK - 273.15f;
+
+            // レンジ1の大半の画素は２回目の評価を省略する
+            if (To < fastLower || To >= fastUpper) {
+                int range = (To >= ct[1]) + (To >= ct[2]) + (To >= ct[3]);
+                toK       = sqrtf(sqrtf(
+                    irData / (alphaCompensated *
+                              (rangeA[range] + rangeB[range] * To)) +
+                    taTr));
+            }
+            auto temp = (int32_t)roundf(
+                (toK + ((float)m5::MLX90640_Class::DATA_OFFSET - 273.15f)) *
+                m5::MLX90640_Class::DATA_RATIO_VALUE);
+            if (temp < 0) {
+                temp = 0;
+            } else if (temp > UINT16_MAX) {
+                temp = UINT16_MAX;
             }
+            result[i] = temp;
         }
 
         // 破損ピクセル箇所の補間処理
@@ -1127,14 +1186,39 @@ bool MLX90640_Class::readFrameData(uint16_t *data) {
 }
 
 void MLX90640_Class::calcTempData(const uint16_t *framedata,
-                                  temp_data_t *tempdata, float emissivity) {
+                                  temp_data_t *tempdata, float emissivity,
+                                  radiance_data_t *radiancedata) {
+    radiance_data_t tmp;
+    if (radiancedata == nullptr) {
+        radiancedata = &tmp;
+    }
+    calcRadianceData(framedata, radiancedata);
+    calcTempData(radiancedata, tempdata, emissivity);
+}
+
+void MLX90640_Class::calcRadianceData(const uint16_t *framedata,
+                                      radiance_data_t *radiancedata) {
     float Ta = MLX90640_params.MLX90640_GetTa(framedata);
 
+    radiancedata->ta = Ta;
     // Reflected temperature based on the sensor ambient temperature
-    float tr = Ta - TA_SHIFT;
+    radiancedata->tr      = Ta - TA_SHIFT;
+    radiancedata->subpage = framedata[833];
+    MLX90640_params.MLX90640_CalculateIR(framedata, Ta, radiancedata->ir);
+}
+
+void MLX90640_Class::calcTempData(const radiance_data_t *radiancedata,
+                                  temp_data_t *tempdata, float emissivity) {
+    calcTempData(radiancedata, tempdata, emissivity, radiancedata->tr);
+}
 
-    tempdata->subpage = framedata[833];
-    MLX90640_params.MLX90640_CalculateTo(framedata, emissivity, tr,
+void MLX90640_Class::calcTempData(const radiance_data_t *radiancedata,
+                                  temp_data_t *tempdata, float emissivity,
+                                  float tr) {
+    tempdata->subpage = radiancedata->subpage;
+    MLX90640_params.MLX90640_CalculateTo(radiancedata->ir,
+                                         radiancedata->subpage,
+                                         radiancedata->ta, emissivity, tr,
                                          tempdata->data);
 }
 
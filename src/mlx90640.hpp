@@ -55,6 +55,15 @@ class MLX90640_Class {
     };
 #pragma pack(pop)
 
+    // 放射率で割る前の補正済み赤外信号。放射率や反射温度を変更した際に
+    // センサの新しいデータを待たずに温度を再計算するために保持する。
+    struct radiance_data_t {
+        float ta;  // sensor ambient temperature
+        float tr;  // reflected temperature
+        uint8_t subpage;
+        float ir[16 * 24];
+    };
+
     bool init(I2C_Master* i2c);
     void setRate(refresh_rate_t rate);
     inline refresh_rate_t getRate(void) const {
@@ -76,8 +85,20 @@ class MLX90640_Class {
                       const temp_data_t* prev_tempdata, uint32_t filter_level,
                       uint8_t monitor_width, uint8_t monitor_height);
 
+    /// calc the compensated IR signal only (temperature is not calculated)
+    void calcRadianceData(const uint16_t* framedata,
+                          radiance_data_t* radiancedata);
+
+    /// radiancedata (optional) receives the compensated IR signal
     void calcTempData(const uint16_t* framedata, temp_data_t* tempdata,
-                      float emissivity);
+                      float emissivity,
+                      radiance_data_t* radiancedata = nullptr);
+
+    /// recalc by the IR signal kept by calcTempData
+    void calcTempData(const radiance_data_t* radiancedata,
+                      temp_data_t* tempdata, float emissivity);
+    void calcTempData(const radiance_data_t* radiancedata,
+                      temp_data_t* tempdata, float emissivity, float tr);
 
    private:
     I2C_Master* _i2c;
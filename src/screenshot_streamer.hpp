@@ -4,6 +4,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <vector>
 
 #include <M5GFX.h>
 #include <WiFiClient.h>
@@ -35,6 +36,10 @@ class screenshot_streamer_t : public jpge::output_stream {
 
     jpge::jpeg_encoder _jpeg_enc;
 
+    // 8bit 描画バッファをエンコードする際の展開表と1行分のバッファ
+    uint16_t _palette332[256];
+    std::vector<uint16_t> _line565;
+
    public:
     screenshot_streamer_t(void);
 
@@ -43,11 +48,21 @@ class screenshot_streamer_t : public jpge::output_stream {
     bool isRequested(void) const {
         return _is_requested;
     };
+    // 次のフレームを待っているクライアントがあるか
+    bool isPending(void) const {
+        return _is_requested || uxQueueMessagesWaiting(_queue_client);
+    }
     void requestScreenShot(WiFiClient* client);
 
     // 新設
     bool initCapture(uint16_t width, uint16_t height);
     bool addQueue(M5Canvas* canvas, uint16_t y);
+    // キュー待機中のバッファが読み終わるまで待つ
+    void waitQueue(void) {
+        while (uxQueueMessagesWaiting(_queue_canvas)) {
+            vTaskDelay(1);
+        }
+    }
 
     enum process_result_t {
         pr_nothing,
@@ -0,0 +1,115 @@
+//! Copyright (c) M5Stack. All rights reserved.
+//! Licensed under the MIT license.
+//! See LICENSE file in the project root for full license information.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+// 静止画撮影用に1サブページ分のフレームデータを積算し、外れ値を除いて平均する。
+//
+// 各ワードについて、最初の数フレーム (seed) の中央値を基準値とし、
+// 基準値からの差の中央値 (MAD) を偏差の初期値とする。
+// 以降のフレームは基準値からの差が clip を超えると外れ値として平均に含めない。
+// clip は偏差の平均の clip_gain 倍 (clip_min 以上) で、採用したサンプルの差で
+// 更新する。seed のフレームは全フレームを受け取った後の clip で判定する。
+// 外れ値は何個でも除外できるが、seed の過半数が外れ値だと基準値自体が外れる。
+// seed は5フレーム (積算が5フレーム未満の場合は3フレーム) とする。
+struct still_accumulator_t {
+    static constexpr const size_t words      = 832;
+    static constexpr const size_t seed_max   = 5;
+    static constexpr const int32_t clip_min  = 16;
+    static constexpr const int32_t clip_gain = 6;
+
+    int16_t seed[seed_max][words];
+    int16_t ref[words];
+    int32_t sum[words];   // seed 以降で採用したサンプルの合計
+    uint32_t dev[words];  // 偏差の初期値と採用したサンプルの差の合計
+    uint8_t accepted[words];
+    uint8_t seed_count;
+    uint8_t count;
+
+    // frames : 積算するフレーム数 (3以上)
+    void reset(uint8_t frames) {
+        seed_count = frames < seed_max ? 3 : seed_max;
+        count      = 0;
+    }
+
+    void add(const uint16_t* data) {
+        if (count < seed_count) {
+            for (size_t i = 0; i < words; ++i) {
+                seed[count][i] = data[i];
+            }
+            if (++count == seed_count) {
+                setReference();
+            }
+            return;
+        }
+        for (size_t i = 0; i < words; ++i) {
+            int32_t v = (int16_t)data[i];
+            int32_t d = abs(v - ref[i]);
+            if (d <= getClip(i)) {
+                sum[i] += v;
+                dev[i] += d;
+                ++accepted[i];
+            }
+        }
+        ++count;
+    }
+
+    // 採用したサンプルの平均値 (四捨五入) を返す。seed が揃った後に呼ぶこと
+    void getResult(uint16_t* dst) const {
+        for (size_t i = 0; i < words; ++i) {
+            int32_t clip = getClip(i);
+            int32_t n    = accepted[i];
+            int32_t v    = sum[i];
+            for (size_t j = 0; j < seed_count; ++j) {
+                int32_t s = seed[j][i];
+                if (abs(s - ref[i]) <= clip) {
+                    v += s;
+                    ++n;
+                }
+            }
+            v      = (v + (v < 0 ? -(n >> 1) : (n >> 1))) / n;
+            dst[i] = (uint16_t)v;
+        }
+    }
+
+   private:
+    int32_t getClip(size_t i) const {
+        int32_t clip = (int32_t)(dev[i] * clip_gain / (accepted[i] + 1u));
+        return clip < clip_min ? clip_min : clip;
+    }
+
+    // 要素数 n (奇数) の配列を並べ替えて中央値を返す
+    static int32_t median(int32_t* v, size_t n) {
+        for (size_t j = 1; j < n; ++j) {
+            int32_t t = v[j];
+            size_t k  = j;
+            for (; k && v[k - 1] > t; --k) {
+                v[k] = v[k - 1];
+            }
+            v[k] = t;
+        }
+        return v[n >> 1];
+    }
+
+    void setReference(void) {
+        int32_t v[seed_max];
+        for (size_t i = 0; i < words; ++i) {
+            for (size_t j = 0; j < seed_count; ++j) {
+                v[j] = seed[j][i];
+            }
+            int32_t m = median(v, seed_count);
+            for (size_t j = 0; j < seed_count; ++j) {
+                v[j] = abs(v[j] - m);
+            }
+            ref[i]      = m;
+            dev[i]      = median(v, seed_count);
+            sum[i]      = 0;
+            accepted[i] = 0;
+        }
+    }
+};
@@ -0,0 +1,179 @@
+//! Copyright (c) M5Stack. All rights reserved.
+//! Licensed under the MIT license.
+//! See LICENSE file in the project root for full license information.
+
+// still_accumulator_t をホスト上で擬似的なセンサデータを使って確認する。
+// 画素ごとの時間方向の標準偏差を、1フレームと Nフレーム積算の静止画で比べる。
+// ファームウェアのビルドでは何も生成しない。ホストでの実行方法:
+//   g++ -std=c++11 -O2 -Wall src/still_accumulator_check.cpp && ./a.out
+#ifndef ARDUINO
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "still_accumulator.hpp"
+
+namespace {
+
+static constexpr const size_t words   = still_accumulator_t::words;
+static constexpr const size_t repeats = 48;
+static constexpr const double sigma   = 12.0;  // ADC値でのノイズ
+
+std::mt19937 rng(1);
+
+// 真値に正規分布のノイズを加え、glitch_rate の確率で任意の値に化けさせる。
+// 化けたワードは glitches を加算する
+void makeFrame(const std::vector<int16_t>& truth, double glitch_rate,
+               uint16_t* dst, std::vector<uint8_t>& glitches) {
+    std::normal_distribution<double> noise(0.0, sigma);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::uniform_int_distribution<int> any(-32768, 32767);
+    for (size_t i = 0; i < words; ++i) {
+        int32_t v = truth[i] + (int32_t)lround(noise(rng));
+        if (uniform(rng) < glitch_rate) {
+            v = any(rng);
+            ++glitches[i];
+        }
+        dst[i] = (uint16_t)(int16_t)v;
+    }
+}
+
+// 以前の方式 (最大値と最小値を1つずつ除いた平均)
+void minMaxMean(const std::vector<std::vector<uint16_t> >& frames,
+                uint16_t* dst) {
+    int32_t div = frames.size() - 2;
+    for (size_t i = 0; i < words; ++i) {
+        int32_t sum = 0;
+        int32_t mn  = INT32_MAX;
+        int32_t mx  = INT32_MIN;
+        for (auto& f : frames) {
+            int32_t v = (int16_t)f[i];
+            sum += v;
+            mn = std::min(mn, v);
+            mx = std::max(mx, v);
+        }
+        int32_t v = sum - mn - mx;
+        dst[i]    = (uint16_t)((v + (v < 0 ? -(div >> 1) : (div >> 1))) / div);
+    }
+}
+
+struct stat_t {
+    double median;  // 画素ごとの標準偏差の中央値
+    double worst;   // 画素ごとの標準偏差の最大値
+};
+
+// results[r][i] : r 回目の出力の i 番目のワード
+stat_t temporalStdDev(const std::vector<std::vector<uint16_t> >& results) {
+    std::vector<double> sd(words);
+    for (size_t i = 0; i < words; ++i) {
+        double s  = 0;
+        double s2 = 0;
+        for (auto& r : results) {
+            double v = (int16_t)r[i];
+            s += v;
+            s2 += v * v;
+        }
+        double n    = results.size();
+        double mean = s / n;
+        sd[i]       = sqrt(std::max(0.0, s2 / n - mean * mean));
+    }
+    std::sort(sd.begin(), sd.end());
+    return {sd[words / 2], sd[words - 1]};
+}
+
+int failure_count = 0;
+
+void expect(bool ok, const char* what, size_t frames, double glitch_rate) {
+    if (!ok) {
+        printf("  N=%zu glitch=%.3f: %s\n", frames, glitch_rate, what);
+        ++failure_count;
+    }
+}
+
+void measure(size_t frames, double glitch_rate) {
+    std::vector<int16_t> truth(words);
+    for (size_t i = 0; i < words; ++i) {
+        truth[i] = (int16_t)(-300 + (int)(i * 37 % 600));
+    }
+
+    static still_accumulator_t acc;
+    std::vector<std::vector<uint16_t> > single;
+    std::vector<std::vector<uint16_t> > still;
+    std::vector<std::vector<uint16_t> > minmax;
+    std::vector<std::vector<uint16_t> > frame(frames,
+                                              std::vector<uint16_t>(words));
+    std::vector<uint16_t> out(words);
+    std::vector<uint8_t> glitches(words);
+    std::vector<bool> lost(words);
+    size_t excluded = 0;
+    for (size_t r = 0; r < repeats; ++r) {
+        acc.reset(frames);
+        std::fill(glitches.begin(), glitches.end(), 0);
+        for (auto& f : frame) {
+            makeFrame(truth, glitch_rate, f.data(), glitches);
+            acc.add(f.data());
+            // seed の過半数が外れ値のワードは仕様上救えないため集計から除く
+            // (真値に置き換える)
+            if (acc.count == acc.seed_count) {
+                for (size_t i = 0; i < words; ++i) {
+                    lost[i] = glitches[i] * 2 > acc.seed_count;
+                }
+            }
+        }
+        single.push_back(frame[0]);
+        acc.getResult(out.data());
+        for (size_t i = 0; i < words; ++i) {
+            if (lost[i]) {
+                out[i] = truth[i];
+                ++excluded;
+            }
+        }
+        still.push_back(out);
+        minMaxMean(frame, out.data());
+        minmax.push_back(out);
+    }
+    auto s1 = temporalStdDev(single);
+    auto sn = temporalStdDev(still);
+    auto sm = temporalStdDev(minmax);
+    printf("%3zu  %6.3f  %7.2f  %7.2f %9.2f  %7.2f %9.2f  %zu\n", frames,
+           glitch_rate, s1.median, sn.median, sn.worst, sm.median, sm.worst,
+           excluded);
+
+    // 許容範囲:
+    //  中央値は理想値 (sigma / sqrt(N)) の 1.25 倍まで。
+    //  最大値は外れ値が漏れていないことの確認として sigma の 1.5 倍まで
+    //  (外れ値が1つでも平均に入ると数百以上になる)
+    double ideal = sigma / sqrt((double)frames);
+    expect(sn.median <= ideal * 1.25, "median std-dev above tolerance",
+           frames, glitch_rate);
+    expect(sn.worst <= sigma * 1.5, "outlier leaked into the mean", frames,
+           glitch_rate);
+}
+
+}  // namespace
+
+int main(void) {
+    printf(
+        "  N  glitch   single    still  (worst)   minmax  (worst)  "
+        "excluded\n");
+    static constexpr const size_t frame_counts[] = {3, 8, 16, 64};
+    // 外れ値なし / 1ワードあたり 0.2% / 1%
+    // (1% では N=16 以上で2つ以上の外れ値を含むワードが毎回数十個ある)
+    static constexpr const double glitch_rates[] = {0.0, 0.002, 0.01};
+    for (auto rate : glitch_rates) {
+        for (auto frames : frame_counts) {
+            measure(frames, rate);
+        }
+    }
+    if (failure_count) {
+        printf("still_accumulator: %d failure(s)\n", failure_count);
+        return 1;
+    }
+    printf("still_accumulator: ok\n");
+    return 0;
+}
+
+#endif
@@ -181,6 +181,16 @@ static bool response_main(draw_param_t* draw_param, connection_t* conn) {
                                      "<option value=\"%d\">%s</option>\n", i,
                                      draw_param->cloud_interval.getText(i)));
     }
+    strbuf +=
+        "</select></li>\n"
+        "<li>Sleep Between:<select id='cloud_dutycycle' "
+        "onchange='f(\"cloud_dutycycle=\" + "
+        "this.options[this.selectedIndex].value)'>";
+    for (int i = 0; i < draw_param->cloud_dutycycle_max; ++i) {
+        strbuf.append(cbuf, snprintf(cbuf, sizeof(cbuf),
+                                     "<option value=\"%d\">%s</option>\n", i,
+                                     draw_param->cloud_dutycycle.getText(i)));
+    }
     strbuf +=
         "</select></li>\n"
         "<li><form "
@@ -263,6 +273,28 @@ static bool response_main(draw_param_t* draw_param, connection_t* conn) {
     }
     strbuf += "</select></li>\n";
 
+    strbuf +=
+        " <li>Idle Skip: <select id='sens_scenegate' "
+        "onchange='f(\"sens_scenegate=\" + "
+        "this.options[this.selectedIndex].value)'>";
+    for (int i = 0; i < draw_param->sens_scenegate_max; ++i) {
+        strbuf.append(cbuf, snprintf(cbuf, sizeof(cbuf),
+                                     "<option value=\"%d\">%s</option>\n", i,
+                                     draw_param->sens_scenegate.getText(i)));
+    }
+    strbuf += "</select></li>\n";
+
+    strbuf +=
+        " <li>Change Sense: <select id='sens_scenesens' "
+        "onchange='f(\"sens_scenesens=\" + "
+        "this.options[this.selectedIndex].value)'>";
+    for (int i = 0; i < draw_param->sens_scenesens_max; ++i) {
+        strbuf.append(cbuf, snprintf(cbuf, sizeof(cbuf),
+                                     "<option value=\"%d\">%s</option>\n", i,
+                                     draw_param->sens_scenesens.getText(i)));
+    }
+    strbuf += "</select></li>\n";
+
     strbuf += " <li> Emissivity: <span id='em'>";
     strbuf.append(cbuf, snprintf(cbuf, sizeof(cbuf), "%d",
                                  draw_param->sens_emissivity.get()));
@@ -271,7 +303,15 @@ static bool response_main(draw_param_t* draw_param, connection_t* conn) {
         "</span><br>\n<input type='range' min='20' max='100' "
         "id='sens_emissivity' onchange='f(\"sens_emissivity=\" + this.value)' "
         "oninput='document.getElementById(\"em\").innerText=this.value'></"
-        "li>\n</ul>\n";
+        "li>\n";
+
+    strbuf += " <li> Reflected Temp: <span id='rt'>";
+    strbuf += draw_param->sens_reflected.getText();
+    strbuf +=
+        "</span><br>\n<input type='range' min='-41' max='100' "
+        "id='sens_reflected' onchange='f(\"sens_reflected=\" + this.value)' "
+        "oninput='document.getElementById(\"rt\").innerText="
+        "(this.value < -40) ? \"Auto\" : this.value'></li>\n</ul>\n";
 
     strbuf +=
         "<label for='tgl_range'>Range</label><input type='checkbox' "
@@ -369,6 +409,72 @@ static bool response_main(draw_param_t* draw_param, connection_t* conn) {
     }
     strbuf += "</select></li>\n";
 
+    strbuf +=
+        "<li> Graph Span:<select id='misc_graphspan' "
+        "onchange='f(\"misc_graphspan=\" + "
+        "this.options[this.selectedIndex].value)'>";
+    for (int i = 0; i < draw_param->misc_graphspan_max; ++i) {
+        strbuf.append(cbuf, snprintf(cbuf, sizeof(cbuf),
+                                     "<option value=\"%d\">%s</option>\n", i,
+                                     draw_param->misc_graphspan.getText(i)));
+    }
+    strbuf += "</select></li>\n";
+
+    strbuf +=
+        "<li> Upscale:<select id='misc_upscale' "
+        "onchange='f(\"misc_upscale=\" + "
+        "this.options[this.selectedIndex].value)'>";
+    for (int i = 0; i < draw_param->misc_upscale_max; ++i) {
+        strbuf.append(cbuf, snprintf(cbuf, sizeof(cbuf),
+                                     "<option value=\"%d\">%s</option>\n", i,
+                                     draw_param->misc_upscale.getText(i)));
+    }
+    strbuf += "</select></li>\n";
+
+    strbuf +=
+        "<li> Dual Core Draw:<select id='misc_dualcore' "
+        "onchange='f(\"misc_dualcore=\" + "
+        "this.options[this.selectedIndex].value)'>";
+    for (int i = 0; i < draw_param->misc_dualcore_max; ++i) {
+        strbuf.append(cbuf, snprintf(cbuf, sizeof(cbuf),
+                                     "<option value=\"%d\">%s</option>\n", i,
+                                     draw_param->misc_dualcore.getText(i)));
+    }
+    strbuf += "</select></li>\n";
+
+    strbuf +=
+        "<li> Draw Buffer:<select id='misc_drawbuf' "
+        "onchange='f(\"misc_drawbuf=\" + "
+        "this.options[this.selectedIndex].value)'>";
+    for (int i = 0; i < draw_param->misc_drawbuf_max; ++i) {
+        strbuf.append(cbuf, snprintf(cbuf, sizeof(cbuf),
+                                     "<option value=\"%d\">%s</option>\n", i,
+                                     draw_param->misc_drawbuf.getText(i)));
+    }
+    strbuf += "</select></li>\n";
+
+    strbuf +=
+        "<li> Headless:<select id='misc_headless' "
+        "onchange='f(\"misc_headless=\" + "
+        "this.options[this.selectedIndex].value)'>";
+    for (int i = 0; i < draw_param->misc_headless_max; ++i) {
+        strbuf.append(cbuf, snprintf(cbuf, sizeof(cbuf),
+                                     "<option value=\"%d\">%s</option>\n", i,
+                                     draw_param->misc_headless.getText(i)));
+    }
+    strbuf += "</select></li>\n";
+
+    strbuf +=
+        "<li> Auto Power:<select id='misc_governor' "
+        "onchange='f(\"misc_governor=\" + "
+        "this.options[this.selectedIndex].value)'>";
+    for (int i = 0; i < draw_param->misc_governor_max; ++i) {
+        strbuf.append(cbuf, snprintf(cbuf, sizeof(cbuf),
+                                     "<option value=\"%d\">%s</option>\n", i,
+                                     draw_param->misc_governor.getText(i)));
+    }
+    strbuf += "</select></li>\n";
+
     strbuf +=
         "<li> Color:<select id='misc_color' onchange='f(\"misc_color=\" + "
         "this.options[this.selectedIndex].value)'>";
@@ -437,6 +543,12 @@ static bool response_param(draw_param_t* draw_param, connection_t* conn) {
                 draw_param->sens_monitorarea.set(v);
             } else if (key == "sens_emissivity") {
                 draw_param->sens_emissivity.set(v);
+            } else if (key == "sens_reflected") {
+                draw_param->sens_reflected.set(v);
+            } else if (key == "sens_scenegate") {
+                draw_param->sens_scenegate.set(v);
+            } else if (key == "sens_scenesens") {
+                draw_param->sens_scenesens.set(v);
             } else if (key == "range_autoswitch") {
                 draw_param->range_autoswitch.set(v);
             } else if (key == "net_jpg_quality") {
@@ -451,6 +563,18 @@ static bool response_param(draw_param_t* draw_param, connection_t* conn) {
                 draw_param->misc_language.set(v);
             } else if (key == "misc_pointer") {
                 draw_param->misc_pointer.set(v);
+            } else if (key == "misc_graphspan") {
+                draw_param->misc_graphspan.set(v);
+            } else if (key == "misc_upscale") {
+                draw_param->misc_upscale.set(v);
+            } else if (key == "misc_dualcore") {
+                draw_param->misc_dualcore.set(v);
+            } else if (key == "misc_drawbuf") {
+                draw_param->misc_drawbuf.set(v);
+            } else if (key == "misc_headless") {
+                draw_param->misc_headless.set(v);
+            } else if (key == "misc_governor") {
+                draw_param->misc_governor.set(v);
             } else if (key == "misc_layout") {
                 draw_param->misc_layout.set(v);
                 draw_param->in_config_mode = false;
@@ -461,6 +585,8 @@ static bool response_param(draw_param_t* draw_param, connection_t* conn) {
             // .set(v); }
             else if (key == "cloud_interval") {
                 draw_param->cloud_interval.set(v);
+            } else if (key == "cloud_dutycycle") {
+                draw_param->cloud_dutycycle.set(v);
             }
         }
         // draw_param->saveNvs();
@@ -490,6 +616,15 @@ static bool response_param(draw_param_t* draw_param, connection_t* conn) {
     strbuf.append(
         cbuf, snprintf(cbuf, sizeof(cbuf), ",\n \"sens_emissivity\": \"%d\"",
                        draw_param->sens_emissivity.get()));
+    strbuf.append(
+        cbuf, snprintf(cbuf, sizeof(cbuf), ",\n \"sens_reflected\": \"%d\"",
+                       draw_param->sens_reflected.get()));
+    strbuf.append(
+        cbuf, snprintf(cbuf, sizeof(cbuf), ",\n \"sens_scenegate\": \"%d\"",
+                       draw_param->sens_scenegate.get()));
+    strbuf.append(
+        cbuf, snprintf(cbuf, sizeof(cbuf), ",\n \"sens_scenesens\": \"%d\"",
+                       draw_param->sens_scenesens.get()));
     strbuf.append(
         cbuf, snprintf(cbuf, sizeof(cbuf), ",\n \"range_autoswitch\": \"%d\"",
                        draw_param->range_autoswitch.get()));
@@ -519,6 +654,24 @@ static bool response_param(draw_param_t* draw_param, connection_t* conn) {
     strbuf.append(cbuf,
                   snprintf(cbuf, sizeof(cbuf), ",\n \"misc_pointer\": \"%d\"",
                            draw_param->misc_pointer.get()));
+    strbuf.append(cbuf,
+                  snprintf(cbuf, sizeof(cbuf), ",\n \"misc_graphspan\": \"%d\"",
+                           draw_param->misc_graphspan.get()));
+    strbuf.append(cbuf,
+                  snprintf(cbuf, sizeof(cbuf), ",\n \"misc_upscale\": \"%d\"",
+                           draw_param->misc_upscale.get()));
+    strbuf.append(cbuf,
+                  snprintf(cbuf, sizeof(cbuf), ",\n \"misc_dualcore\": \"%d\"",
+                           draw_param->misc_dualcore.get()));
+    strbuf.append(cbuf,
+                  snprintf(cbuf, sizeof(cbuf), ",\n \"misc_drawbuf\": \"%d\"",
+                           draw_param->misc_drawbuf.get()));
+    strbuf.append(cbuf,
+                  snprintf(cbuf, sizeof(cbuf), ",\n \"misc_headless\": \"%d\"",
+                           draw_param->misc_headless.get()));
+    strbuf.append(cbuf,
+                  snprintf(cbuf, sizeof(cbuf), ",\n \"misc_governor\": \"%d\"",
+                           draw_param->misc_governor.get()));
     strbuf.append(cbuf,
                   snprintf(cbuf, sizeof(cbuf), ",\n \"misc_layout\": \"%d\"",
                            draw_param->misc_layout.get()));
@@ -528,6 +681,9 @@ static bool response_param(draw_param_t* draw_param, connection_t* conn) {
     strbuf.append(cbuf,
                   snprintf(cbuf, sizeof(cbuf), ",\n \"cloud_interval\": \"%d\"",
                            draw_param->cloud_interval.get()));
+    strbuf.append(
+        cbuf, snprintf(cbuf, sizeof(cbuf), ",\n \"cloud_dutycycle\": \"%d\"",
+                       draw_param->cloud_dutycycle.get()));
     strbuf.append(cbuf,
                   snprintf(cbuf, sizeof(cbuf), ",\n \"cloud_token\": \"%s\"",
                            draw_param->cloud_token.c_str()));
@@ -577,6 +733,218 @@ static bool response_json(draw_param_t* draw_param, connection_t* conn) {
     return true;
 }
 
+// 複数フレームを積算した静止画
+// /still?frames=N : 撮影開始 (N = 各サブページの積算フレーム数 3～64)
+// /still          : 撮影完了後は /json と同じ形式で結果を返す
+static bool response_still(draw_param_t* draw_param, connection_t* conn) {
+    auto client  = &conn->client;
+    int pos      = conn->request_get.find("frames=");
+    bool pending = draw_param->still_request ||
+                   draw_param->still_state == draw_param->still_capturing;
+    if (pos >= 0 && !pending) {
+        int frames = atoi(conn->request_get.c_str() + pos + 7);
+        if (frames < 3) {
+            frames = 3;
+        } else if (frames > 64) {
+            frames = 64;
+        }
+        draw_param->still_request = frames;
+        pending                   = true;
+    }
+
+    std::string strbuf;
+    if (!pending && draw_param->still_state == draw_param->still_ready &&
+        draw_param->still_frame) {
+        // 撮影完了後の結果は次の撮影開始まで書き換わらないためコピーしない
+        const framedata_t& frame = *draw_param->still_frame;
+        strbuf                   = frame.getJsonData();
+    } else {
+        static constexpr const char* status_text[] = {"none", "capturing",
+                                                      "ready", "error"};
+        auto state = pending ? draw_param->still_capturing
+                             : draw_param->still_state;
+        char cbuf[64];
+        strbuf.append(cbuf, snprintf(cbuf, sizeof(cbuf),
+                                     "{\n \"status\": \"%s\"\n}\n",
+                                     status_text[state]));
+    }
+
+    client->print(
+        "HTTP/1.1 200 OK\nContent-Type: application/json; "
+        "charset=UTF-8\nX-Content-Type-Options: nosniff\nConnection: "
+        "keep-alive\nCache-Control: no-cache\n");
+    client->printf("Content-Length: %d\n\n", strbuf.size());
+    client->write(strbuf.c_str(), strbuf.size());
+    client->print("\n");
+    return true;
+}
+
+// クエリ文字列から "key=" に続く値の先頭を探す (見つからなければ nullptr)
+static const char* find_query_value(const std::string& request,
+                                    const char* key) {
+    size_t len = strlen(key);
+    for (size_t pos = request.find(key); pos != std::string::npos;
+         pos        = request.find(key, pos + 1)) {
+        if ((pos == 0 || request[pos - 1] == '&') &&
+            request[pos + len] == '=') {
+            return request.c_str() + pos + len + 1;
+        }
+    }
+    return nullptr;
+}
+
+// /roi?idx=N&x=X&y=Y&w=W&h=H : 領域を設定する (w=0 で無効)
+// /roi : 各領域の設定と最新フレームでの統計値を返す
+static bool response_roi(draw_param_t* draw_param, connection_t* conn) {
+    auto client     = &conn->client;
+    auto& request   = conn->request_get;
+    auto get_number = [&request](const char* key, int* value) {
+        auto str = find_query_value(request, key);
+        if (str) {
+            *value = atoi(str);
+        }
+        return str != nullptr;
+    };
+    auto clamp = [](int v, int max) { return v < 0 ? 0 : v > max ? max : v; };
+    int idx;
+    if (get_number("idx", &idx) && idx >= 0 &&
+        idx < (int)roi_engine_t::roi_max) {
+        auto roi = &draw_param->roi_rect[idx];
+        int v;
+        if (get_number("x", &v)) {
+            roi->x = clamp(v, frame_width - 1);
+        }
+        if (get_number("y", &v)) {
+            roi->y = clamp(v, frame_height - 1);
+        }
+        if (get_number("w", &v)) {
+            roi->w = clamp(v, frame_width - roi->x);
+        }
+        if (get_number("h", &v)) {
+            roi->h = clamp(v, frame_height - roi->y);
+        }
+        // 位置の変更で範囲外になった分を切り詰める
+        roi->w                = clamp(roi->w, frame_width - roi->x);
+        roi->h                = clamp(roi->h, frame_height - roi->y);
+        config_save_countdown = 255;
+    }
+
+    std::string strbuf = "{\n \"roi\": [";
+    char cbuf[128];
+    auto frame = draw_param->frame;
+    for (size_t i = 0; i < roi_engine_t::roi_max; ++i) {
+        auto roi = &draw_param->roi_rect[i];
+        strbuf.append(cbuf, snprintf(cbuf, sizeof(cbuf),
+                                     "%s\n  {\"x\": %d, \"y\": %d, \"w\": %d, "
+                                     "\"h\": %d",
+                                     i ? "," : "", roi->x, roi->y, roi->w,
+                                     roi->h));
+        if (roi->w && roi->h && frame) {
+            auto res = &frame->roi[i];
+            strbuf.append(
+                cbuf,
+                snprintf(cbuf, sizeof(cbuf),
+                         ", \"highest\": %3.1f, \"high_x\": %d, \"high_y\": %d"
+                         ", \"lowest\": %3.1f, \"low_x\": %d, \"low_y\": %d",
+                         convertRawToCelsius(res->highest), res->high_x,
+                         res->high_y, convertRawToCelsius(res->lowest),
+                         res->low_x, res->low_y));
+            strbuf.append(cbuf, snprintf(cbuf, sizeof(cbuf),
+                                         ", \"average\": %3.1f",
+                                         convertRawToCelsius(res->average)));
+        }
+        strbuf += "}";
+    }
+    strbuf += "\n ]\n}\n";
+
+    client->print(
+        "HTTP/1.1 200 OK\nContent-Type: application/json; "
+        "charset=UTF-8\nX-Content-Type-Options: nosniff\nConnection: "
+        "keep-alive\nCache-Control: no-cache\n");
+    client->printf("Content-Length: %d\n\n", strbuf.size());
+    client->write(strbuf.c_str(), strbuf.size());
+    client->print("\n");
+    return true;
+}
+
+// /alarm?idx=N&mode=M&source=S&reference=R&rate=0|1&threshold=T
+//        &hysteresis=H&duration=D : 追加ルールを設定する
+//   threshold, hysteresis は℃ (rate=1 の場合 threshold は℃/秒)、
+//   duration はmsec。mode=0 でルールを無効にする
+// /alarm : 追加ルールの設定と発報状態を返す
+static bool response_alarm(draw_param_t* draw_param, connection_t* conn) {
+    auto client   = &conn->client;
+    auto& request = conn->request_get;
+    auto str      = find_query_value(request, "idx");
+    int idx       = str ? atoi(str) : -1;
+    if (idx >= 0 && idx < (int)alarm_engine_t::rule_max) {
+        alarm_rule_t rule = draw_param->alarm_rules[idx];
+        if ((str = find_query_value(request, "mode"))) {
+            rule.mode = atoi(str) % draw_param_t::alarm_mode_max;
+        }
+        if ((str = find_query_value(request, "source"))) {
+            rule.source = atoi(str) % (roi_engine_t::roi_max + 1);
+        }
+        if ((str = find_query_value(request, "reference"))) {
+            rule.reference = atoi(str) % draw_param_t::alarm_reference_max;
+        }
+        if ((str = find_query_value(request, "rate"))) {
+            rule.rate = atoi(str) ? 1 : 0;
+        }
+        if ((str = find_query_value(request, "threshold"))) {
+            float t        = atof(str);
+            rule.threshold = rule.rate ? (int32_t)(t * 128)
+                                       : convertCelsiusToRaw(t);
+        }
+        if ((str = find_query_value(request, "hysteresis"))) {
+            int h           = atof(str) * 128;
+            rule.hysteresis = h < 0 ? 0 : h > UINT16_MAX ? UINT16_MAX : h;
+        }
+        if ((str = find_query_value(request, "duration"))) {
+            int d         = atoi(str);
+            rule.duration = d < 0 ? 0 : d > UINT16_MAX ? UINT16_MAX : d;
+        }
+        draw_param->alarm_rules[idx] = rule;
+        config_save_countdown        = 255;
+    }
+
+    // ルール番号 0 は設定画面のアラームのため、追加ルールは 1 から
+    uint32_t mask = draw_param->alarm_active_mask;
+    std::string strbuf;
+    char cbuf[160];
+    strbuf.append(cbuf, snprintf(cbuf, sizeof(cbuf),
+                                 "{\n \"active\": %s,\n \"rules\": [",
+                                 draw_param->alarm_active ? "true" : "false"));
+    for (size_t i = 0; i < alarm_engine_t::rule_max; ++i) {
+        auto rule       = &draw_param->alarm_rules[i];
+        float threshold = rule->rate ? rule->threshold / 128.0f
+                                     : convertRawToCelsius(rule->threshold);
+        strbuf.append(
+            cbuf,
+            snprintf(cbuf, sizeof(cbuf),
+                     "%s\n  {\"mode\": %d, \"source\": %d, \"reference\": %d, "
+                     "\"rate\": %d, \"threshold\": %3.1f, ",
+                     i ? "," : "", rule->mode, rule->source, rule->reference,
+                     rule->rate, threshold));
+        strbuf.append(
+            cbuf, snprintf(cbuf, sizeof(cbuf),
+                           "\"hysteresis\": %3.1f, \"duration\": %d, "
+                           "\"active\": %s}",
+                           rule->hysteresis / 128.0f, rule->duration,
+                           (mask & (2u << i)) ? "true" : "false"));
+    }
+    strbuf += "\n ]\n}\n";
+
+    client->print(
+        "HTTP/1.1 200 OK\nContent-Type: application/json; "
+        "charset=UTF-8\nX-Content-Type-Options: nosniff\nConnection: "
+        "keep-alive\nCache-Control: no-cache\n");
+    client->printf("Content-Length: %d\n\n", strbuf.size());
+    client->write(strbuf.c_str(), strbuf.size());
+    client->print("\n");
+    return true;
+}
+
 static bool response_text(draw_param_t* draw_param, connection_t* conn) {
     auto client = &conn->client;
     auto t      = time(nullptr);
@@ -897,6 +1265,146 @@ static bool response_test(draw_param_t* draw_param, connection_t* conn) {
     //*/
 }
 
+// /history?tier=N : グラフ履歴を古い順に返す
+//   tier=0 はフレーム毎、1 は1秒毎、2 は1分毎の min/avg/max
+static bool response_history(draw_param_t* draw_param, connection_t* conn) {
+    auto client = &conn->client;
+    auto str    = find_query_value(conn->request_get, "tier");
+    int tier    = str ? atoi(str) : graph_data_t::tier_second;
+    if (tier < 0 || tier >= graph_data_t::tier_max) {
+        tier = graph_data_t::tier_second;
+    }
+    auto history = &draw_param->graph_data.history[tier];
+    // 記録側と競合しないよう先にインデクスと件数を確定させる
+    uint8_t current_idx = history->current_idx;
+    uint16_t count      = history->count;
+
+    static constexpr const char* name_table[] = {"lowest", "average",
+                                                 "highest"};
+    static constexpr const uint8_t index_table[] = {
+        framedata_t::lowest, framedata_t::average, framedata_t::highest};
+
+    std::string strbuf;
+    strbuf.reserve(count * 18 + 128);
+    char cbuf[64];
+    strbuf.append(cbuf, snprintf(cbuf, sizeof(cbuf),
+                                 "{\n \"tier\": %d,\n \"period_ms\": %u,\n"
+                                 " \"count\": %u",
+                                 tier,
+                                 (unsigned)graph_data_t::tier_period_msec[tier],
+                                 (unsigned)count));
+    for (int i = 0; i < 3; ++i) {
+        auto temp_array = history->temp_arrays[index_table[i]];
+        strbuf.append(cbuf, snprintf(cbuf, sizeof(cbuf), ",\n \"%s\": [",
+                                     name_table[i]));
+        uint8_t idx = current_idx - count;
+        for (int j = 0; j < count; ++j) {
+            ++idx;
+            strbuf.append(cbuf, snprintf(cbuf, sizeof(cbuf), "%s%3.1f",
+                                         j ? "," : "",
+                                         convertRawToCelsius(temp_array[idx])));
+        }
+        strbuf += "]";
+    }
+    strbuf += "\n}\n";
+
+    client->print(
+        "HTTP/1.1 200 OK\nContent-Type: application/json; "
+        "charset=UTF-8\nX-Content-Type-Options: nosniff\nConnection: "
+        "keep-alive\nCache-Control: no-cache\n");
+    client->printf("Content-Length: %d\n\n", strbuf.size());
+    client->write(strbuf.c_str(), strbuf.size());
+    client->print("\n");
+    return true;
+}
+
+// /recording : アラーム前の記録の状態を返す
+// /recording?frame=N : 凍結中の記録から N 番目 (0 が最古) のフレームを返す
+// /recording?rearm=1 : 凍結を解除して記録を再開する
+static bool response_recording(draw_param_t* draw_param, connection_t* conn) {
+    auto client   = &conn->client;
+    auto recorder = &draw_param->frame_recorder;
+    auto& request = conn->request_get;
+    auto str      = find_query_value(request, "rearm");
+    if (str && atoi(str)) {
+        recorder->requestRearm();
+    }
+
+    std::string strbuf;
+    char cbuf[96];
+    static uint16_t pixel_raw[frame_width * frame_height];
+    uint32_t msec;
+    str = find_query_value(request, "frame");
+    if (str && recorder->decode(atoi(str), pixel_raw, &msec)) {
+        strbuf.reserve(frame_width * frame_height * 6 + 128);
+        strbuf.append(cbuf,
+                      snprintf(cbuf, sizeof(cbuf),
+                               "{\n \"frame\": %d,\n \"msec\": %u,\n"
+                               " \"trigger_msec\": %u,\n \"data\": [",
+                               atoi(str), (unsigned)msec,
+                               (unsigned)recorder->getTriggerMsec()));
+        for (size_t i = 0; i < frame_width * frame_height; ++i) {
+            strbuf.append(cbuf, snprintf(cbuf, sizeof(cbuf), "%s%3.1f",
+                                         i ? "," : "",
+                                         convertRawToCelsius(pixel_raw[i])));
+        }
+        strbuf += "]\n}\n";
+    } else {
+        strbuf.append(
+            cbuf, snprintf(cbuf, sizeof(cbuf),
+                           "{\n \"status\": \"%s\",\n \"frames\": %u,\n"
+                           " \"bytes\": %u",
+                           recorder->isFrozen() ? "frozen" : "recording",
+                           (unsigned)recorder->getFrameCount(),
+                           (unsigned)recorder->getUsedBytes()));
+        if (recorder->isFrozen()) {
+            strbuf.append(cbuf, snprintf(cbuf, sizeof(cbuf),
+                                         ",\n \"trigger_msec\": %u",
+                                         (unsigned)recorder->getTriggerMsec()));
+        }
+        strbuf += "\n}\n";
+    }
+
+    client->print(
+        "HTTP/1.1 200 OK\nContent-Type: application/json; "
+        "charset=UTF-8\nX-Content-Type-Options: nosniff\nConnection: "
+        "keep-alive\nCache-Control: no-cache\n");
+    client->printf("Content-Length: %d\n\n", strbuf.size());
+    client->write(strbuf.c_str(), strbuf.size());
+    client->print("\n");
+    return true;
+}
+
+// /stats : 省電力制御の状態と、処理段ごとの直近1秒間の CPU 使用時間 (usec)
+//          を返す
+static bool response_stats(draw_param_t* draw_param, connection_t* conn) {
+    auto client = &conn->client;
+    auto meter  = draw_param->busy_meter;
+    std::string strbuf;
+    char cbuf[160];
+    strbuf.append(
+        cbuf,
+        snprintf(cbuf, sizeof(cbuf),
+                 "{\n \"headless\": %s,\n \"power_idle\": %s,\n"
+                 " \"cpu_mhz\": %u,\n \"busy_usec\": {\"frame\": %u, "
+                 "\"ui\": %u, \"render\": %u}\n}\n",
+                 draw_param->misc_headless ? "true" : "false",
+                 draw_param->power_idle ? "true" : "false",
+                 (unsigned)getCpuFrequencyMhz(),
+                 (unsigned)meter[draw_param_t::busy_frame].usec,
+                 (unsigned)meter[draw_param_t::busy_ui].usec,
+                 (unsigned)meter[draw_param_t::busy_render].usec));
+
+    client->print(
+        "HTTP/1.1 200 OK\nContent-Type: application/json; "
+        "charset=UTF-8\nX-Content-Type-Options: nosniff\nConnection: "
+        "keep-alive\nCache-Control: no-cache\n");
+    client->printf("Content-Length: %d\n\n", strbuf.size());
+    client->write(strbuf.c_str(), strbuf.size());
+    client->print("\n");
+    return true;
+}
+
 struct response_table_t {
     const char* path;
     bool (*response_func)(draw_param_t*, connection_t*);
@@ -906,7 +1414,10 @@ static constexpr const response_table_t response_table[] = {
     {"/", response_top},        {"/main", response_main},
     {"/json", response_json},   {"/text", response_text},
     {"/wifi", response_wifi},   {"/stream", response_stream},
-    {"/param", response_param},
+    {"/param", response_param}, {"/still", response_still},
+    {"/roi", response_roi},     {"/alarm", response_alarm},
+    {"/history", response_history}, {"/recording", response_recording},
+    {"/stats", response_stats},
     // { "/test"   , response_test },
 };
 